@@ -0,0 +1,445 @@
+// woheap: Offline analyzer of heap snapshot dumped by wo_gc_dump_heap_snapshot.
+// Compute dominator tree of object graph, then report retained sizes by roots & by types.
+//
+// Usage: woheap <snapshot file> [top count]
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+
+namespace woheap
+{
+    // Same as wo::gcbase::gcunittype & wo::gcbase::gctype
+    const char* unit_type_names[] = { "string", "array", "map", "gchandle", "closure", "struct" };
+    const char* gc_type_names[] = { "no_gc", "eden", "young", "old" };
+    const char* root_kind_names[] = { "global", "register", "stack" };
+
+    constexpr uint32_t VIRTUAL_ROOT = 0;
+    constexpr uint32_t UNDEFINED = UINT32_MAX;
+
+    struct root_record
+    {
+        uint8_t  m_kind;
+        uint32_t m_vm_index;
+        uint64_t m_slot;
+        uint64_t m_unit_id;
+        uint32_t m_node = UNDEFINED;
+    };
+
+    struct heap_graph
+    {
+        // Node 0 is virtual root, which points to all roots & no_gc units.
+        std::vector<uint64_t>   m_ids;
+        std::vector<uint8_t>    m_unit_types;
+        std::vector<uint8_t>    m_gc_types;
+        std::vector<uint64_t>   m_sizes;
+        std::vector<uint64_t>   m_edge_begins;
+        std::vector<uint32_t>   m_edges;
+        std::vector<root_record> m_roots;
+
+        size_t node_count() const
+        {
+            return m_ids.size();
+        }
+        const char* type_name(uint32_t node) const
+        {
+            if (node == VIRTUAL_ROOT)
+                return "<root>";
+            return m_unit_types[node] < std::size(unit_type_names)
+                ? unit_type_names[m_unit_types[node]] : "<unknown>";
+        }
+    };
+
+    class snapshot_reader
+    {
+        FILE* m_file;
+        bool m_failed = false;
+    public:
+        snapshot_reader(FILE* file)
+            : m_file(file)
+        {
+        }
+        template<typename T>
+        T read()
+        {
+            T data = {};
+            if (1 != fread(&data, sizeof(T), 1, m_file))
+                m_failed = true;
+            return data;
+        }
+        void read_array(uint64_t* out, size_t count)
+        {
+            if (count != fread(out, sizeof(uint64_t), count, m_file))
+                m_failed = true;
+        }
+        bool failed() const
+        {
+            return m_failed;
+        }
+    };
+
+    bool load_snapshot(const char* path, heap_graph* graph)
+    {
+        FILE* file = fopen(path, "rb");
+        if (file == nullptr)
+        {
+            fprintf(stderr, "Failed to open '%s'.\n", path);
+            return false;
+        }
+
+        std::vector<char> file_buffer(1 << 20);
+        setvbuf(file, file_buffer.data(), _IOFBF, file_buffer.size());
+
+        char magic[8] = {};
+        if (8 != fread(magic, 1, 8, file) || 0 != memcmp(magic, "WOHEAP01", 8))
+        {
+            fprintf(stderr, "'%s' is not a woolang heap snapshot.\n", path);
+            fclose(file);
+            return false;
+        }
+
+        graph->m_ids.push_back(0);
+        graph->m_unit_types.push_back(0);
+        graph->m_gc_types.push_back(0);
+        graph->m_sizes.push_back(0);
+        graph->m_edge_begins.push_back(0);
+
+        // Edges are stored as unit ids at first, and will be replaced by node index after all nodes loaded.
+        std::vector<uint64_t> edge_ids;
+        snapshot_reader reader(file);
+
+        bool finished = false;
+        while (!finished && !reader.failed())
+        {
+            switch (reader.read<char>())
+            {
+            case 'R':
+            {
+                root_record root;
+                root.m_kind = reader.read<uint8_t>();
+                root.m_vm_index = reader.read<uint32_t>();
+                root.m_slot = reader.read<uint64_t>();
+                root.m_unit_id = reader.read<uint64_t>();
+                graph->m_roots.push_back(root);
+                break;
+            }
+            case 'N':
+            {
+                graph->m_ids.push_back(reader.read<uint64_t>());
+                graph->m_unit_types.push_back(reader.read<uint8_t>());
+                graph->m_gc_types.push_back(reader.read<uint8_t>());
+                graph->m_sizes.push_back(reader.read<uint64_t>());
+                graph->m_edge_begins.push_back(edge_ids.size());
+
+                const uint32_t edge_count = reader.read<uint32_t>();
+                const size_t edge_begin = edge_ids.size();
+                edge_ids.resize(edge_begin + edge_count);
+                reader.read_array(edge_ids.data() + edge_begin, edge_count);
+                break;
+            }
+            case 'E':
+                finished = true;
+                break;
+            default:
+                if (!reader.failed())
+                    fprintf(stderr, "Bad record in '%s'.\n", path);
+                fclose(file);
+                return false;
+            }
+        }
+        fclose(file);
+
+        if (!finished)
+        {
+            fprintf(stderr, "Unexpected end of '%s', snapshot might be incomplete.\n", path);
+            return false;
+        }
+
+        // Map unit ids to node index.
+        std::vector<uint32_t> sorted_nodes(graph->node_count() - 1);
+        std::iota(sorted_nodes.begin(), sorted_nodes.end(), 1);
+        std::sort(sorted_nodes.begin(), sorted_nodes.end(), [graph](uint32_t a, uint32_t b)
+            {
+                return graph->m_ids[a] < graph->m_ids[b];
+            });
+        auto find_node = [&](uint64_t id)
+        {
+            auto fnd = std::lower_bound(sorted_nodes.begin(), sorted_nodes.end(), id, [graph](uint32_t node, uint64_t id)
+                {
+                    return graph->m_ids[node] < id;
+                });
+            if (fnd != sorted_nodes.end() && graph->m_ids[*fnd] == id)
+                return *fnd;
+            return UNDEFINED;
+        };
+
+        // Edges of virtual root.
+        std::vector<uint32_t> root_edges;
+        for (auto& root : graph->m_roots)
+        {
+            root.m_node = find_node(root.m_unit_id);
+            if (root.m_node != UNDEFINED)
+                root_edges.push_back(root.m_node);
+        }
+        for (uint32_t node = 1; node < graph->node_count(); ++node)
+            if (graph->m_gc_types[node] == 0 /* no_gc */)
+                root_edges.push_back(node);
+
+        graph->m_edges = std::move(root_edges);
+        graph->m_edges.reserve(graph->m_edges.size() + edge_ids.size());
+
+        const size_t root_edge_count = graph->m_edges.size();
+        for (uint64_t id : edge_ids)
+            // Units which not in snapshot(such as constant string) are ignored.
+            graph->m_edges.push_back(find_node(id));
+
+        edge_ids.clear();
+        edge_ids.shrink_to_fit();
+
+        for (uint32_t node = 1; node < graph->node_count(); ++node)
+            graph->m_edge_begins[node] += root_edge_count;
+        graph->m_edge_begins.push_back(graph->m_edges.size());
+
+        return true;
+    }
+
+    struct dominator_tree
+    {
+        std::vector<uint32_t> m_post_order; // Only reachable nodes.
+        std::vector<uint32_t> m_idoms;
+        std::vector<uint64_t> m_retained_sizes;
+    };
+
+    // Cooper, Harvey & Kennedy: A Simple, Fast Dominance Algorithm.
+    void compute_dominators(const heap_graph& graph, dominator_tree* tree)
+    {
+        const size_t node_count = graph.node_count();
+
+        // Post order of nodes reachable from virtual root.
+        auto& post_order = tree->m_post_order;
+        std::vector<uint32_t> post_order_index(node_count, UNDEFINED);
+        do
+        {
+            std::vector<uint8_t> visited(node_count, 0);
+            std::vector<std::pair<uint32_t, uint64_t>> walking_stack;
+
+            visited[VIRTUAL_ROOT] = 1;
+            walking_stack.push_back({ VIRTUAL_ROOT, graph.m_edge_begins[VIRTUAL_ROOT] });
+            while (!walking_stack.empty())
+            {
+                auto& [node, edge_index] = walking_stack.back();
+                if (edge_index < graph.m_edge_begins[node + 1])
+                {
+                    uint32_t child = graph.m_edges[edge_index++];
+                    if (child != UNDEFINED && !visited[child])
+                    {
+                        visited[child] = 1;
+                        walking_stack.push_back({ child, graph.m_edge_begins[child] });
+                    }
+                }
+                else
+                {
+                    post_order_index[node] = (uint32_t)post_order.size();
+                    post_order.push_back(node);
+                    walking_stack.pop_back();
+                }
+            }
+        } while (0);
+
+        // Predecessors of reachable nodes.
+        std::vector<uint64_t> pred_begins(node_count + 1, 0);
+        std::vector<uint32_t> preds;
+        do
+        {
+            for (uint32_t node : post_order)
+                for (uint64_t i = graph.m_edge_begins[node]; i < graph.m_edge_begins[node + 1]; ++i)
+                    if (graph.m_edges[i] != UNDEFINED)
+                        ++pred_begins[graph.m_edges[i] + 1];
+
+            std::partial_sum(pred_begins.begin(), pred_begins.end(), pred_begins.begin());
+            preds.resize(pred_begins.back());
+
+            std::vector<uint64_t> pred_fill(pred_begins.begin(), pred_begins.end() - 1);
+            for (uint32_t node : post_order)
+                for (uint64_t i = graph.m_edge_begins[node]; i < graph.m_edge_begins[node + 1]; ++i)
+                    if (graph.m_edges[i] != UNDEFINED)
+                        preds[pred_fill[graph.m_edges[i]]++] = node;
+        } while (0);
+
+        auto& idoms = tree->m_idoms;
+        idoms.assign(node_count, UNDEFINED);
+        idoms[VIRTUAL_ROOT] = VIRTUAL_ROOT;
+
+        auto intersect = [&](uint32_t a, uint32_t b)
+        {
+            while (a != b)
+            {
+                while (post_order_index[a] < post_order_index[b])
+                    a = idoms[a];
+                while (post_order_index[b] < post_order_index[a])
+                    b = idoms[b];
+            }
+            return a;
+        };
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            // Walk in reverse post order, skip virtual root.
+            for (size_t i = post_order.size() - 1; i-- > 0;)
+            {
+                const uint32_t node = post_order[i];
+                uint32_t new_idom = UNDEFINED;
+                for (uint64_t p = pred_begins[node]; p < pred_begins[node + 1]; ++p)
+                {
+                    const uint32_t pred = preds[p];
+                    if (idoms[pred] == UNDEFINED)
+                        continue;
+                    new_idom = new_idom == UNDEFINED ? pred : intersect(pred, new_idom);
+                }
+                if (new_idom != idoms[node])
+                {
+                    idoms[node] = new_idom;
+                    changed = true;
+                }
+            }
+        }
+
+        // Children are always before their dominator in post order.
+        auto& retained_sizes = tree->m_retained_sizes;
+        retained_sizes.assign(node_count, 0);
+        for (uint32_t node : post_order)
+        {
+            retained_sizes[node] += graph.m_sizes[node];
+            if (node != VIRTUAL_ROOT)
+                retained_sizes[idoms[node]] += retained_sizes[node];
+        }
+    }
+
+    void report(const heap_graph& graph, const dominator_tree& tree, size_t top_count)
+    {
+        const size_t node_count = graph.node_count();
+        const uint64_t total_bytes = std::accumulate(graph.m_sizes.begin(), graph.m_sizes.end(), (uint64_t)0);
+
+        printf("Units: %zu, edges: %zu, roots: %zu\n",
+            node_count - 1, graph.m_edges.size(), graph.m_roots.size());
+        printf("Total bytes: %llu, reachable bytes: %llu\n\n",
+            (unsigned long long)total_bytes, (unsigned long long)tree.m_retained_sizes[VIRTUAL_ROOT]);
+
+        // By types: retained size of a type only counts units not dominated by other unit of same type.
+        std::vector<uint64_t> type_counts(std::size(unit_type_names)), type_shallow_bytes(std::size(unit_type_names));
+        std::vector<uint64_t> type_retained_bytes(std::size(unit_type_names));
+        for (uint32_t node = 1; node < node_count; ++node)
+        {
+            if (graph.m_unit_types[node] < std::size(unit_type_names))
+            {
+                ++type_counts[graph.m_unit_types[node]];
+                type_shallow_bytes[graph.m_unit_types[node]] += graph.m_sizes[node];
+            }
+        }
+        do
+        {
+            // Types of units in dominator chain, dominators are always before their children in reverse post order.
+            std::vector<uint8_t> dominator_type_masks(node_count, 0);
+            for (size_t i = tree.m_post_order.size(); i-- > 0;)
+            {
+                const uint32_t node = tree.m_post_order[i];
+                if (node == VIRTUAL_ROOT || graph.m_unit_types[node] >= std::size(unit_type_names))
+                    continue;
+
+                const uint8_t type_mask = (uint8_t)(1 << graph.m_unit_types[node]);
+                const uint32_t idom = tree.m_idoms[node];
+
+                dominator_type_masks[node] = dominator_type_masks[idom];
+                if (idom != VIRTUAL_ROOT)
+                    dominator_type_masks[node] |= (uint8_t)(1 << graph.m_unit_types[idom]);
+
+                if (!(dominator_type_masks[node] & type_mask))
+                    type_retained_bytes[graph.m_unit_types[node]] += tree.m_retained_sizes[node];
+            }
+        } while (0);
+
+        printf("%-10s %12s %16s %16s\n", "type", "count", "shallow bytes", "retained bytes");
+        for (uint8_t type = 0; type < std::size(unit_type_names); ++type)
+        {
+            if (type_counts[type] != 0)
+                printf("%-10s %12llu %16llu %16llu\n", unit_type_names[type],
+                    (unsigned long long)type_counts[type],
+                    (unsigned long long)type_shallow_bytes[type],
+                    (unsigned long long)type_retained_bytes[type]);
+        }
+
+        // By roots: Units only reachable from this root.
+        printf("\nTop roots by retained bytes:\n");
+        std::vector<const root_record*> roots;
+        for (auto& root : graph.m_roots)
+            if (root.m_node != UNDEFINED)
+                roots.push_back(&root);
+        std::sort(roots.begin(), roots.end(), [&tree](const root_record* a, const root_record* b)
+            {
+                return tree.m_retained_sizes[a->m_node] > tree.m_retained_sizes[b->m_node];
+            });
+        for (size_t i = 0; i < roots.size() && i < top_count; ++i)
+        {
+            const root_record* root = roots[i];
+            printf("  vm#%u %-8s [%llu] -> %-8s %#llx  retained %llu%s\n",
+                root->m_vm_index,
+                root->m_kind < std::size(root_kind_names) ? root_kind_names[root->m_kind] : "<unknown>",
+                (unsigned long long)root->m_slot,
+                graph.type_name(root->m_node),
+                (unsigned long long)root->m_unit_id,
+                (unsigned long long)tree.m_retained_sizes[root->m_node],
+                tree.m_idoms[root->m_node] == VIRTUAL_ROOT ? "" : " (shared)");
+        }
+
+        printf("\nTop units by retained bytes:\n");
+        std::vector<uint32_t> nodes;
+        for (uint32_t node = 1; node < node_count; ++node)
+            if (tree.m_idoms[node] != UNDEFINED)
+                nodes.push_back(node);
+
+        const size_t shown_count = std::min(nodes.size(), top_count);
+        std::partial_sort(nodes.begin(), nodes.begin() + shown_count, nodes.end(), [&tree](uint32_t a, uint32_t b)
+            {
+                return tree.m_retained_sizes[a] > tree.m_retained_sizes[b];
+            });
+        for (size_t i = 0; i < shown_count; ++i)
+        {
+            const uint32_t node = nodes[i];
+            printf("  %-8s %#llx %-5s shallow %llu  retained %llu  dominator %#llx\n",
+                graph.type_name(node),
+                (unsigned long long)graph.m_ids[node],
+                graph.m_gc_types[node] < std::size(gc_type_names) ? gc_type_names[graph.m_gc_types[node]] : "?",
+                (unsigned long long)graph.m_sizes[node],
+                (unsigned long long)tree.m_retained_sizes[node],
+                (unsigned long long)graph.m_ids[tree.m_idoms[node]]);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: woheap <snapshot file> [top count]\n");
+        return -1;
+    }
+
+    const size_t top_count = argc >= 3 ? (size_t)atoll(argv[2]) : 20;
+
+    woheap::heap_graph graph;
+    if (!woheap::load_snapshot(argv[1], &graph))
+        return -2;
+
+    woheap::dominator_tree tree;
+    woheap::compute_dominators(graph, &tree);
+    woheap::report(graph, tree, top_count);
+
+    return 0;
+}
@@ -262,6 +262,12 @@ WO_API void         wo_map_clear(wo_value map);
 WO_API wo_bool_t    wo_map_is_empty(wo_value arr);
 
 WO_API wo_bool_t    wo_gchandle_close(wo_value gchandle);
+// Prompt gchandle holds scarce resource (like file & socket), it is reference counted and closed
+// when the last slot holding it is overwritten or popped. Gchandle should be only held by the given
+// value when set. Gc will be requested when too many prompt gchandles alive, so the dropped ones
+// which are not released (such as in freed containers) will be closed soon, see
+// config::GC_PROMPT_HANDLE_LIMIT.
+WO_API void         wo_gchandle_set_prompt(wo_value gchandle);
 
 // Here to define RSRuntime code accroding to the type.
 
@@ -277,6 +283,59 @@ WO_API void         wo_gc_stop();
 WO_API void         wo_gc_pause();
 WO_API void         wo_gc_resume();
 
+typedef struct _wo_gc_stats
+{
+    // All time is in seconds, all statistics of counts & bytes is of last gc round.
+    uint64_t    cycle_count;
+    wo_bool_t   is_minor_collect;
+
+    double      pause_time;     // Time of stopping the world, includes time to safepoint.
+    double      max_pause_time;
+    double      total_pause_time;
+    double      max_time_to_safepoint; // Time for vm to hang up after interrupted by gc.
+    double      avg_time_to_safepoint;
+    double      max_time_to_resume;    // Time for hanged-up vm to run again after gc resumed it, of all rounds.
+    double      avg_time_to_resume;
+    double      mark_time;
+    double      sweep_time;
+
+    uint64_t    eden_count;     // All eden units will be moved to young.
+    uint64_t    eden_bytes;
+    uint64_t    young_live_count;
+    uint64_t    young_live_bytes;
+    uint64_t    young_freed_count;
+    uint64_t    young_freed_bytes;
+    uint64_t    promoted_count; // Young units moved to old.
+    uint64_t    promoted_bytes;
+    uint64_t    old_live_count;
+    uint64_t    old_live_bytes;
+    uint64_t    old_freed_count;    // Old units will only be freed in full gc.
+    uint64_t    old_freed_bytes;
+
+    uint64_t    memo_record_count;  // Units recorded by write barrier while marking.
+    double      allocate_rate;      // Bytes allocated per second.
+
+    uint64_t    large_object_count; // Units holding large buffers, they are collected with old units.
+    uint64_t    large_object_bytes; // Bytes mapped by large-object space.
+
+    uint64_t    finalizer_backlog_count;    // Dead gchandles waiting for (or being) closed.
+    uint64_t    finalized_count;            // Total gchandles closed by finalizer threads.
+    uint64_t    prompt_handle_count;        // Prompt gchandles which are not closed or found dead.
+}
+wo_gc_stats;
+
+typedef void(*wo_gc_stats_callback)(const wo_gc_stats* stats);
+
+WO_API void         wo_gc_get_stats(wo_gc_stats* out_stats);
+// Callback will be invoked in gc-thread after each gc round, return old callback.
+WO_API wo_gc_stats_callback wo_gc_regist_stats_callback(wo_gc_stats_callback callback);
+// Do a full gc with stopping the world, and write all alive units & roots to file, see woheap.
+WO_API wo_bool_t    wo_gc_dump_heap_snapshot(wo_string_t path);
+// Limit bytes of units & their containers in the heap of vm (the isolated heap of vm, or default heap
+// shared by whole runtime), vm allocating more will fail with WO_FAIL_MEMORY_QUOTA. 0 means no limit.
+WO_API void         wo_gc_set_memory_quota(wo_vm vm, size_t max_bytes);
+WO_API size_t       wo_gc_get_memory_used(wo_vm vm);
+
 WO_API void         wo_attach_default_debuggee(wo_vm vm);
 WO_API wo_bool_t    wo_has_attached_debuggee(wo_vm vm);
 WO_API void         wo_disattach_debuggee(wo_vm vm);
@@ -317,6 +376,8 @@ WO_API wo_string_t  wo_debug_trace_callstack(wo_vm vm, size_t layer);
 //
 #define WO_FAIL_MEDIUM 0xB000
 
+#define WO_FAIL_MEMORY_QUOTA 0xB001
+
 // Heavy error:
 // Such errors will make it difficult for the program to continue running.
 // Due to the lack of an appropriate default solution, ignoring such errors will
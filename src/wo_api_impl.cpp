@@ -215,6 +215,27 @@ void wo_init(int argc, char** argv)
     bool enable_gc = true;
     size_t coroutine_mgr_thread_count = 4;
 
+    if (const char* env_gc_worker_count = getenv("WOOLANG_GC_WORKER_COUNT"))
+        wo::config::GC_WORKER_THREAD_COUNT = (size_t)atoll(env_gc_worker_count);
+    if (const char* env_gc_finalizer_count = getenv("WOOLANG_GC_FINALIZER_COUNT"))
+        wo::config::GC_FINALIZER_THREAD_COUNT = (size_t)atoll(env_gc_finalizer_count);
+    if (const char* env_gc_nursery_size = getenv("WOOLANG_GC_NURSERY_SIZE"))
+        wo::config::GC_NURSERY_SIZE = (size_t)atoll(env_gc_nursery_size);
+    if (const char* env_gc_large_object_size = getenv("WOOLANG_GC_LARGE_OBJECT_SIZE"))
+        wo::config::GC_LARGE_OBJECT_SIZE = (size_t)atoll(env_gc_large_object_size);
+    if (const char* env_gc_stop_the_world_size = getenv("WOOLANG_GC_STOP_THE_WORLD_SIZE"))
+        wo::config::GC_STOP_THE_WORLD_SIZE = (size_t)atoll(env_gc_stop_the_world_size);
+    if (const char* env_gc_adaptive = getenv("WOOLANG_GC_ADAPTIVE"))
+        wo::config::ENABLE_GC_ADAPTIVE_THRESHOLD = atoi(env_gc_adaptive);
+    if (const char* env_gc_minor = getenv("WOOLANG_GC_MINOR"))
+        wo::config::ENABLE_GC_MINOR_COLLECTION = atoi(env_gc_minor);
+    if (const char* env_gc_isolated_heap = getenv("WOOLANG_GC_ISOLATED_HEAP"))
+        wo::config::ENABLE_GC_ISOLATED_HEAP = atoi(env_gc_isolated_heap);
+    if (const char* env_gc_root_scan_budget = getenv("WOOLANG_GC_ROOT_SCAN_BUDGET"))
+        wo::config::GC_ROOT_SCAN_PAUSE_BUDGET = (size_t)atoll(env_gc_root_scan_budget);
+    if (const char* env_gc_prompt_handle_limit = getenv("WOOLANG_GC_PROMPT_HANDLE_LIMIT"))
+        wo::config::GC_PROMPT_HANDLE_LIMIT = (size_t)atoll(env_gc_prompt_handle_limit);
+
     for (int command_idx = 0; command_idx + 1 < argc; command_idx++)
     {
         std::string current_arg = argv[command_idx];
@@ -233,6 +254,28 @@ void wo_init(int argc, char** argv)
                 wo::config::ENABLE_IR_CODE_ACTIVE_ALLIGN = atoi(argv[++command_idx]);
             else if ("enable-ansi-color" == current_arg)
                 wo::config::ENABLE_OUTPUT_ANSI_COLOR_CTRL = atoi(argv[++command_idx]);
+            else if ("enable-eliminated-func-info" == current_arg)
+                wo::config::ENABLE_OUTPUT_ELIMINATED_FUNCTION_INFO = atoi(argv[++command_idx]);
+            else if ("gc-worker-count" == current_arg)
+                wo::config::GC_WORKER_THREAD_COUNT = (size_t)atoll(argv[++command_idx]);
+            else if ("gc-finalizer-count" == current_arg)
+                wo::config::GC_FINALIZER_THREAD_COUNT = (size_t)atoll(argv[++command_idx]);
+            else if ("gc-nursery-size" == current_arg)
+                wo::config::GC_NURSERY_SIZE = (size_t)atoll(argv[++command_idx]);
+            else if ("gc-large-object-size" == current_arg)
+                wo::config::GC_LARGE_OBJECT_SIZE = (size_t)atoll(argv[++command_idx]);
+            else if ("gc-stop-the-world-size" == current_arg)
+                wo::config::GC_STOP_THE_WORLD_SIZE = (size_t)atoll(argv[++command_idx]);
+            else if ("enable-gc-adaptive" == current_arg)
+                wo::config::ENABLE_GC_ADAPTIVE_THRESHOLD = atoi(argv[++command_idx]);
+            else if ("enable-gc-minor" == current_arg)
+                wo::config::ENABLE_GC_MINOR_COLLECTION = atoi(argv[++command_idx]);
+            else if ("enable-gc-isolated-heap" == current_arg)
+                wo::config::ENABLE_GC_ISOLATED_HEAP = atoi(argv[++command_idx]);
+            else if ("gc-root-scan-budget" == current_arg)
+                wo::config::GC_ROOT_SCAN_PAUSE_BUDGET = (size_t)atoll(argv[++command_idx]);
+            else if ("gc-prompt-handle-limit" == current_arg)
+                wo::config::GC_PROMPT_HANDLE_LIMIT = (size_t)atoll(argv[++command_idx]);
             else if ("coroutine-thread-count" == current_arg)
                 coroutine_mgr_thread_count = atoi(argv[++command_idx]);
             else
@@ -251,6 +294,7 @@ void wo_init(int argc, char** argv)
     {
         wo_virtual_source(wo_stdlib_src_path, wo_stdlib_src_data, false);
         wo_virtual_source(wo_stdlib_debug_src_path, wo_stdlib_debug_src_data, false);
+        wo_virtual_source(wo_stdlib_gc_src_path, wo_stdlib_gc_src_data, false);
         wo_virtual_source(wo_stdlib_vm_src_path, wo_stdlib_vm_src_data, false);
         wo_virtual_source(wo_stdlib_thread_src_path, wo_stdlib_thread_src_data, false);
         wo_virtual_source(wo_stdlib_roroutine_src_path, wo_stdlib_roroutine_src_data, false);
@@ -448,17 +492,22 @@ void wo_set_gchandle(wo_value value, wo_ptr_t resource_ptr, wo_value holding_val
     auto handle_ptr = wo::gchandle_t::gc_new<wo::gcbase::gctype::eden>(WO_VAL(value)->gcunit);
     handle_ptr->holding_handle = resource_ptr;
     if (holding_val)
-    {
-        handle_ptr->holding_value.set_val(WO_VAL(holding_val));
-        if (handle_ptr->holding_value.is_gcunit())
-            handle_ptr->holding_value.gcunit->gc_type = wo::gcbase::gctype::no_gc;
-    }
+        handle_ptr->set_holding_value(WO_VAL(holding_val));
     handle_ptr->destructor = destruct_func;
 }
 void wo_set_val(wo_value value, wo_value val)
 {
     auto _rsvalue = WO_VAL(value);
-    _rsvalue->set_val(WO_VAL(val));
+    auto _val = WO_VAL(val);
+
+    // Values MUST NOT be passed between vms of different isolated heaps.
+    wo_assert(wo::gcheap::thread_heap == nullptr
+        || !_val->is_gcunit()
+        || _val->gcunit == nullptr
+        || _val->gcunit->gc_heap_id == 0
+        || _val->gcunit->gc_heap_id == wo::gcheap::thread_heap->m_id);
+
+    _rsvalue->set_val(_val);
 }
 void wo_set_ref(wo_value value, wo_value val)
 {
@@ -1063,11 +1112,7 @@ wo_result_t wo_ret_gchandle(wo_vm vm, wo_ptr_t resource_ptr, wo_value holding_va
     auto handle_ptr = wo::gchandle_t::gc_new<wo::gcbase::gctype::eden>(WO_VM(vm)->cr->gcunit);
     handle_ptr->holding_handle = resource_ptr;
     if (holding_val)
-    {
-        handle_ptr->holding_value.set_val(WO_VAL(holding_val));
-        if (handle_ptr->holding_value.is_gcunit())
-            handle_ptr->holding_value.gcunit->gc_type = wo::gcbase::gctype::no_gc;
-    }
+        handle_ptr->set_holding_value(WO_VAL(holding_val));
     handle_ptr->destructor = destruct_func;
 
     return reinterpret_cast<wo_result_t>(WO_VM(vm)->cr);
@@ -1257,11 +1302,7 @@ wo_result_t wo_ret_option_gchandle(wo_vm vm, wo_ptr_t resource_ptr, wo_value hol
     auto handle_ptr = wo::gchandle_t::gc_new<wo::gcbase::gctype::eden>(structptr->m_values[1].gcunit);
     handle_ptr->holding_handle = resource_ptr;
     if (holding_val)
-    {
-        handle_ptr->holding_value.set_val(WO_VAL(holding_val));
-        if (handle_ptr->holding_value.is_gcunit())
-            handle_ptr->holding_value.gcunit->gc_type = wo::gcbase::gctype::no_gc;
-    }
+        handle_ptr->set_holding_value(WO_VAL(holding_val));
     handle_ptr->destructor = destruct_func;
 
     return 0;
@@ -1348,7 +1389,18 @@ wo_bool_t wo_virtual_source(wo_string_t filepath, wo_string_t data, wo_bool_t en
 
 wo_vm wo_create_vm()
 {
-    return (wo_vm)new wo::vm;
+    wo::vmbase* vm = new wo::vm;
+
+    // Vm created in running vm (like std::vm::create) might share values with it, use same heap.
+    if (auto* running_vm = wo::vmbase::_this_thread_vm)
+    {
+        if ((vm->gc_heap = running_vm->gc_heap))
+            wo::gcheap::add_vm(vm->gc_heap);
+    }
+    else if (wo::config::ENABLE_GC_ISOLATED_HEAP)
+        vm->gc_heap = wo::gcheap::create();
+
+    return CS_VM(vm);
 }
 
 wo_vm wo_sub_vm(wo_vm vm, size_t stacksz)
@@ -1527,62 +1579,58 @@ wo_bool_t wo_abort_vm(wo_vm vm)
 
 wo_value wo_push_int(wo_vm vm, wo_int_t val)
 {
-    return CS_VAL((WO_VM(vm)->sp--)->set_integer(val));
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil()->set_integer(val));
 }
 wo_value wo_push_real(wo_vm vm, wo_real_t val)
 {
-    return CS_VAL((WO_VM(vm)->sp--)->set_real(val));
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil()->set_real(val));
 }
 wo_value wo_push_handle(wo_vm vm, wo_handle_t val)
 {
-    return CS_VAL((WO_VM(vm)->sp--)->set_handle(val));
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil()->set_handle(val));
 }
 wo_value wo_push_pointer(wo_vm vm, wo_ptr_t val)
 {
-    return CS_VAL((WO_VM(vm)->sp--)->set_handle((wo_handle_t)val));
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil()->set_handle((wo_handle_t)val));
 }
 wo_value wo_push_gchandle(wo_vm vm, wo_ptr_t resource_ptr, wo_value holding_val, void(*destruct_func)(wo_ptr_t))
 {
-    auto* csp = WO_VM(vm)->sp--;
+    auto* csp = (WO_VM(vm)->sp--)->init_nil();
 
     csp->set_gcunit_with_barrier(wo::value::valuetype::gchandle_type);
     auto handle_ptr = wo::gchandle_t::gc_new<wo::gcbase::gctype::eden>(csp->gcunit);
     handle_ptr->holding_handle = resource_ptr;
     if (holding_val)
-    {
-        handle_ptr->holding_value.set_val(WO_VAL(holding_val));
-        if (handle_ptr->holding_value.is_gcunit())
-            handle_ptr->holding_value.gcunit->gc_type = wo::gcbase::gctype::no_gc;
-    }
+        handle_ptr->set_holding_value(WO_VAL(holding_val));
     handle_ptr->destructor = destruct_func;
 
     return CS_VAL(csp);
 }
 wo_value wo_push_string(wo_vm vm, wo_string_t val)
 {
-    return CS_VAL((WO_VM(vm)->sp--)->set_string(val));
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil()->set_string(val));
 }
 wo_value wo_push_empty(wo_vm vm)
 {
-    return CS_VAL((WO_VM(vm)->sp--)->set_nil());
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil());
 }
 wo_value wo_push_val(wo_vm vm, wo_value val)
 {
     if (val)
-        return CS_VAL((WO_VM(vm)->sp--)->set_val(WO_VAL(val)));
-    return CS_VAL((WO_VM(vm)->sp--)->set_nil());
+        return CS_VAL((WO_VM(vm)->sp--)->init_nil()->set_val(WO_VAL(val)));
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil());
 }
 wo_value wo_push_ref(wo_vm vm, wo_value val)
 {
     if (val)
-        return CS_VAL((WO_VM(vm)->sp--)->set_ref(WO_VAL(val)));
-    return CS_VAL((WO_VM(vm)->sp--)->set_nil());
+        return CS_VAL((WO_VM(vm)->sp--)->init_nil()->set_ref(WO_VAL(val)));
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil());
 }
 wo_value wo_push_valref(wo_vm vm, wo_value val)
 {
     if (val)
-        return CS_VAL((WO_VM(vm)->sp--)->set_trans(WO_ORIGIN_VAL(val)));
-    return CS_VAL((WO_VM(vm)->sp--)->set_nil());
+        return CS_VAL((WO_VM(vm)->sp--)->init_nil()->set_trans(WO_ORIGIN_VAL(val)));
+    return CS_VAL((WO_VM(vm)->sp--)->init_nil());
 }
 
 
@@ -1592,6 +1640,7 @@ wo_value wo_top_stack(wo_vm vm)
 }
 void wo_pop_stack(wo_vm vm)
 {
+    wo::value::release_popped_slots(WO_VM(vm)->sp + 1, WO_VM(vm)->sp + 2, WO_VM(vm)->cr);
     ++WO_VM(vm)->sp;
 }
 wo_value wo_invoke_rsfunc(wo_vm vm, wo_int_t vmfunc, wo_int_t argc)
@@ -1740,6 +1789,8 @@ void wo_arr_resize(wo_value arr, wo_int_t newsz, wo_value init_val)
                 _arr->array->add_memo(&(*_arr->array)[i]);
         }
         _arr->array->resize((size_t)newsz, *WO_VAL(init_val));
+        for (size_t i = arrsz; i < (size_t)newsz; ++i)
+            (*_arr->array)[i].hold_counted_handle();
     }
     else
         wo_fail(WO_FAIL_TYPE_FAIL, "Value is not an array.");
@@ -1786,7 +1837,10 @@ wo_value wo_arr_add(wo_value arr, wo_value elem)
         wo::gcbase::gc_write_guard g1(_arr->array);
 
         if (elem)
+        {
             _arr->array->push_back(*WO_VAL(elem));
+            _arr->array->back().hold_counted_handle();
+        }
         else
             _arr->array->emplace_back(wo::value());
 
@@ -1935,8 +1989,10 @@ wo_value wo_map_get_by_default(wo_value map, wo_value index, wo_value default_va
         } while (false);
         if (!result)
         {
+            // Key is copied into map without setter.
+            WO_VAL(index)->hold_counted_handle();
             if (default_value)
-                result = &((*_map->mapping)[*WO_VAL(index)] = *WO_VAL(default_value));
+                result = (*_map->mapping)[*WO_VAL(index)].set_val(WO_VAL(default_value));
             else
             {
                 result = &((*_map->mapping)[*WO_VAL(index)]);
@@ -2015,11 +2071,16 @@ wo_value wo_map_set(wo_value map, wo_value index, wo_value val)
     else if (_map->type == wo::value::valuetype::mapping_type)
     {
         wo::gcbase::gc_write_guard g1(_map->mapping);
+        auto [place, inserted] = _map->mapping->try_emplace(*WO_VAL(index));
+        // Key is copied into map without setter.
+        if (inserted)
+            place->first.hold_counted_handle();
+
         wo::value* result;
         if (val)
-            result = (*_map->mapping)[*WO_VAL(index)].set_val(WO_VAL(val));
+            result = place->second.set_val(WO_VAL(val));
         else
-            result = (*_map->mapping)[*WO_VAL(index)].set_nil();
+            result = place->second.set_nil();
 
         return CS_VAL(result);
     }
@@ -2097,6 +2158,12 @@ wo_bool_t wo_gchandle_close(wo_value gchandle)
     return false;
 }
 
+void wo_gchandle_set_prompt(wo_value gchandle)
+{
+    wo_assert(WO_VAL(gchandle)->type == wo::value::valuetype::gchandle_type);
+    WO_VAL(gchandle)->gchandle->set_prompt();
+}
+
 // DEBUGGEE TOOLS
 void wo_attach_default_debuggee(wo_vm vm)
 {
@@ -2146,9 +2213,9 @@ wo_string_t wo_debug_trace_callstack(wo_vm vm, size_t layer)
     std::stringstream sstream;
     WO_VM(vm)->dump_call_stack(layer, false, sstream);
 
-    wo_set_string(CS_VAL(WO_VM(vm)->er), "");
+    // Strings cannot be modified after created, their bytes are counted when allocating.
+    wo_set_string(CS_VAL(WO_VM(vm)->er), sstream.str().c_str());
     wo_assert(WO_VM(vm)->er->type == wo::value::valuetype::string_type);
 
-    *(WO_VM(vm)->er->string) = sstream.str();
     return WO_VM(vm)->er->string->c_str();
 }
\ No newline at end of file
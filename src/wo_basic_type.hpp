@@ -26,9 +26,13 @@ namespace wo
     using byte_t = uint8_t;
     using hash_t = uint64_t;
 
+    // Buffers of containers are allocated by gc_allocator, so they are counted into the heap.
+    using mapping_storage_t = std::map<value, value, value_compare, gc_allocator<std::pair<const value, value>>>;
+    using array_storage_t = std::vector<value, gc_allocator<value>>;
+
     using string_t = gcunit<std::string>;
-    using mapping_t = gcunit<std::map<value, value, value_compare>>;
-    using array_t = gcunit<std::vector<value>>;
+    using mapping_t = gcunit<mapping_storage_t>;
+    using array_t = gcunit<array_storage_t>;
 
     template<typename ... TS>
     using cxx_vec_t = std::vector<TS...>;
@@ -45,6 +49,19 @@ namespace wo
     using closure_t = gcunit<closure_function>;
     using struct_t = gcunit<struct_values>;
 
+    template<>
+    struct gcunit_type_tag<std::string> { static constexpr gcbase::gcunittype value = gcbase::gcunittype::string; };
+    template<>
+    struct gcunit_type_tag<array_storage_t> { static constexpr gcbase::gcunittype value = gcbase::gcunittype::array; };
+    template<>
+    struct gcunit_type_tag<mapping_storage_t> { static constexpr gcbase::gcunittype value = gcbase::gcunittype::mapping; };
+    template<>
+    struct gcunit_type_tag<gc_handle_base_t> { static constexpr gcbase::gcunittype value = gcbase::gcunittype::gchandle; };
+    template<>
+    struct gcunit_type_tag<closure_function> { static constexpr gcbase::gcunittype value = gcbase::gcunittype::closure; };
+    template<>
+    struct gcunit_type_tag<struct_values> { static constexpr gcbase::gcunittype value = gcbase::gcunittype::structure; };
+
     struct value
     {
         //  value
@@ -62,6 +79,9 @@ namespace wo
             is_ref,
             callstack,
             nativecallstack,
+            // Callstack guarded by gc, returning by it will scan the frame returned to,
+            // see vmbase::gc_return_barrier. Only used in vm's stack.
+            barriercallstack,
 
             need_gc = 0xF0,
 
@@ -122,20 +142,59 @@ namespace wo
             return const_cast<value*>(this);
         }
 
+        // Counted gchandle held by the slot is released after the slot overwritten, it is pinned
+        // before so gc will not free it while releasing, see gc_handle_base_t::ref_count.
+        struct counted_handle_releaser
+        {
+            gc_handle_base_t* m_handle;
+
+            inline counted_handle_releaser(const value* slot);
+            inline ~counted_handle_releaser();
+        };
+        // Hold counted gchandle in the value, should be called when the value copied into a slot
+        // without setters, such as inserting into containers.
+        inline void hold_counted_handle() const;
+        inline static void hold_counted_handle(gcbase* handle_unit);
+        // Release counted gchandles in slots [begin, end) to be popped, slot referenced by 'cr'
+        // will be read after returned, keep it.
+        inline static void release_popped_slots(value* begin, value* end, const value* cr);
+
+        // Stale slots (such as popped stack) might hold freed units, values pushed should be
+        // initialized without releasing.
+        inline value* init_nil()
+        {
+            type = valuetype::invalid;
+            handle = 0;
+            return this;
+        }
+
         inline value* set_gcunit_with_barrier(valuetype gcunit_type)
         {
+            counted_handle_releaser r(this);
+#ifdef WO_SINGLE_THREADED
+            handle = 0;
+            type = gcunit_type;
+#else
             *std::launder(reinterpret_cast<std::atomic<wo_handle_t*>*>(&handle)) = nullptr;
             *std::launder(reinterpret_cast<std::atomic_uint8_t*>(&type)) = (uint8_t)gcunit_type;
-
+#endif
             return this;
         }
 
         inline value* set_gcunit_with_barrier(valuetype gcunit_type, gcbase* gcunit_ptr)
         {
+            if (gcunit_type == valuetype::gchandle_type)
+                hold_counted_handle(gcunit_ptr);
+            counted_handle_releaser r(this);
+#ifdef WO_SINGLE_THREADED
+            handle = 0;
+            type = gcunit_type;
+            gcunit = gcunit_ptr;
+#else
             *std::launder(reinterpret_cast<std::atomic<wo_handle_t*>*>(&handle)) = nullptr;
             *std::launder(reinterpret_cast<std::atomic_uint8_t*>(&type)) = (uint8_t)gcunit_type;
             *std::launder(reinterpret_cast<std::atomic<gcbase*>*>(&gcunit)) = gcunit_ptr;
-
+#endif
             return this;
         }
 
@@ -154,30 +213,35 @@ namespace wo
         }
         inline value* set_integer(wo_integer_t val)
         {
+            counted_handle_releaser r(this);
             type = valuetype::integer_type;
             integer = val;
             return this;
         }
         inline value* set_real(wo_real_t val)
         {
+            counted_handle_releaser r(this);
             type = valuetype::real_type;
             real = val;
             return this;
         }
         inline value* set_handle(wo_handle_t val)
         {
+            counted_handle_releaser r(this);
             type = valuetype::handle_type;
             handle = val;
             return this;
         }
         inline value* set_nil()
         {
+            counted_handle_releaser r(this);
             type = valuetype::invalid;
             handle = 0;
             return this;
         }
         inline value* set_native_callstack(const wo::byte_t* ipplace)
         {
+            counted_handle_releaser r(this);
             type = valuetype::nativecallstack;
             native_function_addr = ipplace;
             return this;
@@ -193,6 +257,9 @@ namespace wo
 
         inline gcbase* get_gcunit_with_barrier() const
         {
+#ifdef WO_SINGLE_THREADED
+            return is_gcunit() ? gcunit : nullptr;
+#endif
             do
             {
                 gcbase* gcunit_addr = *std::launder(reinterpret_cast<const std::atomic<gcbase*>*>(&gcunit));
@@ -237,6 +304,7 @@ namespace wo
                 wo_assert(_ref && _ref->type != valuetype::is_ref,
                     "illegal reflect, 'ref' only able to store ONE layer of reflect, and should not be nullptr.");
 
+                counted_handle_releaser r(this);
                 type = valuetype::is_ref;
                 ref = _ref;
             }
@@ -250,6 +318,18 @@ namespace wo
             return set_val(_ref);
         }
 
+        // Value in 'unit' is copied & validated before set, so torn value will not be seen by
+        // gc-markers reading this slot, see gcbase::gc_optimistic_read.
+        inline value* set_trans_optimistically(gcbase* unit, const value* _val)
+        {
+            value read_val;
+            gcbase::gc_optimistic_read(unit, [&]()
+                {
+                    read_val = *_val;
+                });
+            return set_trans(&read_val);
+        }
+
         inline bool is_gcunit() const
         {
             return (uint8_t)type & (uint8_t)valuetype::need_gc;
@@ -262,6 +342,7 @@ namespace wo
                 set_gcunit_with_barrier(_val->type, _val->gcunit);
             else
             {
+                counted_handle_releaser r(this);
                 type = _val->type;
                 handle = _val->handle;
             }
@@ -355,25 +436,32 @@ namespace wo
         struct_values(uint16_t sz) noexcept
             : m_count(sz)
         {
-            m_values = (value*)malloc(sz * sizeof(value));
+            const size_t memsz = sz * sizeof(value);
+            m_values = (value*)(los::is_large(memsz) ? los::alloc(memsz) : malloc(memsz));
             for (uint16_t i = 0; i < sz; ++i)
-                m_values[i].set_nil();
+                m_values[i].init_nil();
         }
         ~struct_values()
         {
             wo_assert(m_values);
-            free(m_values);
+
+            const size_t memsz = m_count * sizeof(value);
+            if (los::is_large(memsz))
+                los::free(m_values, memsz);
+            else
+                free(m_values);
         }
     };
 
     struct closure_function
     {
         wo_integer_t m_function_addr;
-        std::vector<value> m_closure_args;
+        std::vector<value, gc_allocator<value>> m_closure_args;
     };
 
     struct gc_handle_base_t
     {
+        // used in gc::_gc_holding_handles
         gc_handle_base_t* last = nullptr;
 
         value holding_value = {};
@@ -383,14 +471,91 @@ namespace wo
         std::atomic_flag has_been_closed_af = {};
         bool has_been_closed = false;
 
+        // Weak gchandle will not mark the units it holds, slots holding unmarked units will be
+        // cleared by gc after marking, see gc::_gc_clear_weak_slots.
+        //  weak_value: holding_value is weakly held.
+        //  weak_keyed_map: holding_handle is weak_keyed_map_t, keys are weakly held.
+        enum class weak_type : uint8_t
+        {
+            not_weak,
+            weak_value,
+            weak_keyed_map,
+        };
+        // Keys of weak map are compared by identity, so arrays/structs/closures can be used.
+        struct weak_key_compare
+        {
+            bool operator()(const value& lhs, const value& rhs) const
+            {
+                if (lhs.type == rhs.type
+                    && lhs.is_gcunit()
+                    && lhs.type != value::valuetype::string_type)
+                    return ((intptr_t)lhs.gcunit) < ((intptr_t)rhs.gcunit);
+                return value_compare()(lhs, rhs);
+            }
+        };
+        using weak_keyed_map_t = std::map<value, value, weak_key_compare>;
+
+        weak_type weak = weak_type::not_weak;
+
+        // Linked in gc::_gc_holding_handles, it will be freed by gc-thread after closed.
+        bool is_registered = false;
+
+        // Dead gchandle will be closed by gc finalizer threads, see gc::_gc_scan_holding_handles.
+        bool is_finalizing = false;
+        std::atomic_bool is_finalized = false;
+
+        // Prompt gchandles which are not closed or found dead, see set_prompt.
+        bool is_prompt = false;
+        inline static std::atomic_size_t alive_prompt_count = 0;
+
+        // Prompt gchandle is counted by slots holding it, and closed when the last one is
+        // overwritten or popped. Slots dropped without releasing (such as in containers freed
+        // by gc) only inflate the count, tracing gc still closes it when found dead.
+        //  releasing_count pins the gchandle while releasing, gc will not free it.
+        bool is_counted = false;
+        std::atomic_size_t ref_count = 0;
+        std::atomic_uint32_t releasing_count = 0;
+        // Popped slots are only released after any counted gchandle created.
+        inline static std::atomic_bool counted_handle_created = false;
+
+        // Following functions are defined in wo_gc_work.cpp
+        // holding_value will be marked by gc until the gchandle closed.
+        void set_holding_value(value* val);
+        // Make gchandle weak, holding_value or holding_handle should be set before.
+        void set_weak(weak_type type);
+        // Read weakly held holding_value, return false if it has been cleared. out_val should
+        // be traced by gc, such as vm's stack.
+        bool get_weak_value(value* out_val);
+        // Make gchandle prompt, gc will be requested when too many prompt gchandles alive.
+        // Gchandle should be held by only one slot, it will be counted from then on.
+        void set_prompt();
+        // Called by pinned releaser, close the gchandle if it is the last reference and unpin.
+        void release_reference();
+
+        bool need_close() const
+        {
+            return !has_been_closed && (destructor != nullptr || is_registered);
+        }
+
         bool close()
         {
             if (!has_been_closed_af.test_and_set())
             {
+                // Weak slots might be clearing by gc-thread.
+                gcbase* weak_unit = weak == weak_type::not_weak ? nullptr : static_cast<gchandle_t*>(this);
+                if (weak_unit)
+                    weak_unit->write();
+
                 has_been_closed = true;
+                // Dead prompt gchandle has been counted when it found by gc.
+                if (is_prompt && !is_finalizing)
+                    --alive_prompt_count;
                 if (destructor)
                     destructor(holding_handle);
-                if (holding_value.is_gcunit())
+
+                if (weak_unit)
+                    weak_unit->write_end();
+                else if (holding_value.is_gcunit())
                     holding_value.gcunit->gc_type = gcbase::gctype::young;
                 return true;
             }
@@ -403,6 +568,145 @@ namespace wo
         }
     };
 
+    inline value::counted_handle_releaser::counted_handle_releaser(const value* slot)
+        : m_handle(nullptr)
+    {
+        if (slot->type == valuetype::gchandle_type
+            && slot->gchandle != nullptr
+            && slot->gchandle->is_counted)
+        {
+            m_handle = slot->gchandle;
+            ++m_handle->releasing_count;
+        }
+    }
+    inline value::counted_handle_releaser::~counted_handle_releaser()
+    {
+        if (m_handle != nullptr)
+            m_handle->release_reference();
+    }
+    inline void value::hold_counted_handle(gcbase* handle_unit)
+    {
+        gchandle_t* handle = static_cast<gchandle_t*>(handle_unit);
+        if (handle != nullptr && handle->is_counted)
+            ++handle->ref_count;
+    }
+    inline void value::hold_counted_handle() const
+    {
+        if (type == valuetype::gchandle_type)
+            hold_counted_handle(gchandle);
+    }
+    inline void value::release_popped_slots(value* begin, value* end, const value* cr)
+    {
+        if (!gc_handle_base_t::counted_handle_created.load(std::memory_order_relaxed))
+            return;
+
+        for (value* slot = begin; slot < end; ++slot)
+        {
+            if (slot->type == valuetype::gchandle_type
+                && !(cr->type == valuetype::is_ref && cr->ref == slot))
+                slot->set_nil();
+        }
+    }
+
+    inline void gcbase::gc_destruct()
+    {
+        switch (gc_unit_type)
+        {
+        case gcunittype::string:
+            static_cast<string_t*>(this)->~string_t(); break;
+        case gcunittype::array:
+            static_cast<array_t*>(this)->~array_t(); break;
+        case gcunittype::mapping:
+            static_cast<mapping_t*>(this)->~mapping_t(); break;
+        case gcunittype::gchandle:
+            static_cast<gchandle_t*>(this)->~gchandle_t(); break;
+        case gcunittype::closure:
+            static_cast<closure_t*>(this)->~closure_t(); break;
+        case gcunittype::structure:
+            static_cast<struct_t*>(this)->~struct_t(); break;
+        default:
+            wo_error("Unknown gcunit type.");
+        }
+    }
+
+    inline size_t gcbase::gc_size()
+    {
+        switch (gc_unit_type)
+        {
+        case gcunittype::array:
+        {
+            gc_mark_read_guard g1(this);
+            return sizeof(array_t) + static_cast<array_t*>(this)->capacity() * sizeof(value);
+        }
+        case gcunittype::mapping:
+        {
+            gc_mark_read_guard g1(this);
+            // Node of std::map holds the pair & links of red-black tree.
+            return sizeof(mapping_t) + static_cast<mapping_t*>(this)->size()
+                * (sizeof(std::pair<const value, value>) + 4 * sizeof(void*));
+        }
+        case gcunittype::closure:
+            return sizeof(closure_t) + static_cast<closure_t*>(this)->m_closure_args.capacity() * sizeof(value);
+        default:
+            return gc_self_size();
+        }
+    }
+
+    inline size_t gcbase::gc_self_size()
+    {
+        switch (gc_unit_type)
+        {
+        case gcunittype::string:
+        {
+            // Short string is stored in std::string itself, string will not be modified after created.
+            const std::string& str = *static_cast<string_t*>(this);
+            const bool is_short = str.data() >= (const char*)&str && str.data() < (const char*)(&str + 1);
+            return sizeof(string_t) + (is_short ? 0 : str.capacity() + 1);
+        }
+        case gcunittype::array:
+            return sizeof(array_t);
+        case gcunittype::mapping:
+            return sizeof(mapping_t);
+        case gcunittype::gchandle:
+            return sizeof(gchandle_t);
+        case gcunittype::closure:
+            return sizeof(closure_t);
+        case gcunittype::structure:
+            return sizeof(struct_t) + static_cast<struct_t*>(this)->m_count * sizeof(value);
+        default:
+            wo_error("Unknown gcunit type.");
+        }
+        return 0;
+    }
+
+    inline bool gcbase::gc_is_large_object()
+    {
+        switch (gc_unit_type)
+        {
+        case gcunittype::string:
+        {
+            gc_mark_read_guard g1(this);
+            return los::is_large(static_cast<string_t*>(this)->capacity());
+        }
+        case gcunittype::array:
+        {
+            gc_mark_read_guard g1(this);
+            return los::is_large(static_cast<array_t*>(this)->capacity() * sizeof(value));
+        }
+        case gcunittype::structure:
+            return los::is_large(static_cast<struct_t*>(this)->m_count * sizeof(value));
+        default:
+            return false;
+        }
+    }
+
+    inline void gcbase::gc_delete(gcbase* unit)
+    {
+        const uint8_t size_class = unit->gc_size_class;
+        unit->gc_destruct();
+        slab::free(unit, size_class);
+    }
+
     inline value* value::set_dup(value* from)
     {
         // TODO: IF A VAL HAS IT REF; IN CONST VAL, WILL STILL HAS POSSIBLE TO MODIFY THE VAL;
@@ -416,6 +720,8 @@ namespace wo
 
                 auto* created_arr = array_t::gc_new<gcbase::gctype::eden>(gcunit, dup_arrray->size());
                 *created_arr = *dup_arrray;
+                for (auto& val : *created_arr)
+                    val.hold_counted_handle();
             }
             else
                 set_nil();
@@ -431,6 +737,11 @@ namespace wo
 
                 auto* created_map = mapping_t::gc_new<gcbase::gctype::eden>(gcunit);
                 *created_map = *dup_mapping;
+                for (auto& [key, val] : *created_map)
+                {
+                    key.hold_counted_handle();
+                    val.hold_counted_handle();
+                }
             }
             else
                 set_nil();
@@ -440,12 +751,11 @@ namespace wo
             auto* dup_struct = from->structs;
             if (dup_struct)
             {
-                gcbase::gc_read_guard g1(dup_struct);
                 set_gcunit_with_barrier(valuetype::struct_type);
 
                 auto* created_struct = struct_t::gc_new<gcbase::gctype::eden>(gcunit, dup_struct->m_count);
                 for (uint16_t i = 0; i < dup_struct->m_count; ++i)
-                    created_struct->m_values[i].set_trans(&dup_struct->m_values[i]);
+                    created_struct->m_values[i].set_trans_optimistically(dup_struct, &dup_struct->m_values[i]);
             }
             else
                 set_nil();
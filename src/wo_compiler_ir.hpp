@@ -11,6 +11,7 @@
 #include "wo_shared_ptr.hpp"
 #include "wo_memory.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 
@@ -167,6 +168,17 @@ namespace wo
             }
         };
 
+        struct tag_table :virtual opnumbase
+        {
+            std::vector<std::string> names;
+
+            tag_table(const std::vector<std::string>& _names)
+                : names(_names)
+            {
+
+            }
+        };
+
         template<typename T>
         struct imm :virtual immbase
         {
@@ -384,6 +396,7 @@ namespace wo
         */
 
         friend struct vmbase;
+        friend class lang;
 
         struct ir_command
         {
@@ -403,6 +416,9 @@ namespace wo
                 instruct::extern_opcode_page_3 ext_opcode_p3;
             };
 
+            // Only for calln, see pure_call_flag.
+            uint8_t pure_call_flags = 0;
+
 #define WO_IS_REG(OPNUM)(dynamic_cast<opnum::reg*>(OPNUM))
             uint8_t dr()
             {
@@ -615,6 +631,703 @@ namespace wo
             return (int32_t)tr_regist_mapping.size();
         }
 
+        // Flags of calln which invokes an extern function declared as 'pure', marked by lang.
+        enum pure_call_flag : uint8_t
+        {
+            PURE_CALL = 0b0001,
+            // All arguments are constants or immutable variables, they will only be written
+            // when initializing.
+            PURE_CALL_IMMUTABLE_ARGS = 0b0010,
+            // The result might depend on the values which arguments refer to (such as elements of
+            // array), they might be changed by impure function or writing through ref.
+            PURE_CALL_READ_REFERRED = 0b0100,
+        };
+
+        void mark_last_call_as_pure(uint8_t flags)
+        {
+            wo_assert(flags & PURE_CALL);
+            wo_assert(!ir_command_buffer.empty() && ir_command_buffer.back().opcode == instruct::calln);
+            ir_command_buffer.back().pure_call_flags = flags;
+        }
+
+    private:
+        // Pure value: commands which calculate a value to cr without side effect.
+        //  1) psh args...; [set tc, argc;] calln pure_func; pop argc
+        //  2) idstruct cr, struct, offset; [idstruct cr, cr, offset; ...]
+        //      (Only if cr will be read as value after it.)
+        struct pure_value
+        {
+            size_t begin;
+            size_t end;
+            cxx_vec_t<opnum::opnumbase*> operands;
+            bool immutable_operands;
+            bool read_referred;
+            bool using_tc;
+        };
+        struct ir_edit
+        {
+            size_t ip;
+            size_t erase_count;
+            // Commands in 'hoisted' will be inserted before the moved tag, and
+            // commands in 'replaced' will be inserted after it.
+            cxx_vec_t<ir_command> hoisted;
+            std::string moved_tag;
+            cxx_vec_t<ir_command> replaced;
+        };
+        struct pure_value_analyze_context
+        {
+            size_t begin;
+            size_t end;
+            std::map<std::string, size_t> tag_ips;
+            std::set<size_t> tagged_ips;
+            cxx_vec_t<opnum::opnumbase*> ref_slots;
+            cxx_vec_t<opnum::opnumbase*> escaped_slots;
+            cxx_vec_t<pure_value> pure_values;
+        };
+
+        static bool _is_reg(opnum::opnumbase* op, uint8_t id)
+        {
+            auto* r = dynamic_cast<opnum::reg*>(op);
+            return r && r->id == id;
+        }
+        static bool _is_pure_value_operand(opnum::opnumbase* op)
+        {
+            if (dynamic_cast<opnum::immbase*>(op) || dynamic_cast<opnum::global*>(op))
+                return true;
+            if (auto* r = dynamic_cast<opnum::reg*>(op))
+                return r->is_tmp_regist() || r->is_bp_offset();
+            return false;
+        }
+        static bool _is_same_operand(opnum::opnumbase* a, opnum::opnumbase* b)
+        {
+            if (a == b)
+                return true;
+            if (a == nullptr || b == nullptr)
+                return false;
+            if (auto* ra = dynamic_cast<opnum::reg*>(a))
+            {
+                auto* rb = dynamic_cast<opnum::reg*>(b);
+                return rb && ra->id == rb->id;
+            }
+            if (auto* ga = dynamic_cast<opnum::global*>(a))
+            {
+                auto* gb = dynamic_cast<opnum::global*>(b);
+                return gb && ga->offset == gb->offset;
+            }
+            if (auto* ia = dynamic_cast<opnum::immbase*>(a))
+            {
+                auto* ib = dynamic_cast<opnum::immbase*>(b);
+                return ib && ia->type() == ib->type() && !(*ia < *ib) && !(*ib < *ia);
+            }
+            return false;
+        }
+        static bool _is_same_command(const ir_command& a, const ir_command& b)
+        {
+            if (a.opcode != b.opcode || a.opinteger != b.opinteger)
+                return false;
+            if (a.opcode == instruct::calln)
+                // calln's op1 is the native function, see 'call'.
+                return a.op1 == b.op1 && a.op2 == nullptr && b.op2 == nullptr;
+            return _is_same_operand(a.op1, b.op1) && _is_same_operand(a.op2, b.op2);
+        }
+        static bool _is_end_of_block(const ir_command& cmd)
+        {
+            switch (cmd.opcode)
+            {
+            case instruct::jt:
+            case instruct::jf:
+            case instruct::jmp:
+            case instruct::jnequb:
+            case instruct::ret:
+            case instruct::abrt:
+                return true;
+            case instruct::ext:
+                return cmd.ext_page_id == 0
+                    && (cmd.ext_opcode_p0 == instruct::extern_opcode_page_0::veh
+                        || cmd.ext_opcode_p0 == instruct::extern_opcode_page_0::jmptab);
+            default:
+                return false;
+            }
+        }
+        static bool _is_impure_call(const ir_command& cmd)
+        {
+            return cmd.opcode == instruct::call
+                || (cmd.opcode == instruct::calln && !(cmd.pure_call_flags & PURE_CALL));
+        }
+        // Get the operand which will be written by the command, if the value which
+        // the operand refers to will be written, out_through_ref will be set.
+        static opnum::opnumbase* _get_written_operand(const ir_command& cmd, bool* out_through_ref)
+        {
+            *out_through_ref = false;
+            switch (cmd.opcode)
+            {
+            case instruct::nop:
+            case instruct::psh:
+            case instruct::pshr:
+            case instruct::call:
+            case instruct::calln:
+            case instruct::ret:
+            case instruct::jt:
+            case instruct::jf:
+            case instruct::jmp:
+            case instruct::jnequb:
+            case instruct::typeas:
+            case instruct::equb:
+            case instruct::nequb:
+            case instruct::equx:
+            case instruct::nequx:
+            case instruct::lti:
+            case instruct::gti:
+            case instruct::elti:
+            case instruct::egti:
+            case instruct::ltx:
+            case instruct::gtx:
+            case instruct::eltx:
+            case instruct::egtx:
+            case instruct::ltr:
+            case instruct::gtr:
+            case instruct::eltr:
+            case instruct::egtr:
+            case instruct::land:
+            case instruct::lor:
+            case instruct::idx:
+            case instruct::abrt:
+                return nullptr;
+            case instruct::set:
+            case instruct::setcast:
+            case instruct::idstruct:
+            case instruct::popr:
+            case instruct::ldsr:
+                return cmd.op1;
+            case instruct::ext:
+                if (cmd.ext_page_id != 0)
+                    return nullptr;
+                switch (cmd.ext_opcode_p0)
+                {
+                case instruct::extern_opcode_page_0::setref:
+                case instruct::extern_opcode_page_0::trans:
+                    return cmd.op1;
+                case instruct::extern_opcode_page_0::packargs:
+                case instruct::extern_opcode_page_0::movdup:
+                    *out_through_ref = true;
+                    return cmd.op1;
+                case instruct::extern_opcode_page_0::nextarr:
+                    *out_through_ref = true;
+                    return cmd.op2;
+                default:
+                    return nullptr;
+                }
+            default:
+                // pop, mov, addi, mkarr ... write to the value that op1 refers to.
+                *out_through_ref = true;
+                return cmd.op1;
+            }
+        }
+        static bool _is_in_operands(const cxx_vec_t<opnum::opnumbase*>& operands, opnum::opnumbase* op)
+        {
+            for (auto* operand : operands)
+                if (_is_same_operand(operand, op))
+                    return true;
+            return false;
+        }
+        static bool _is_global_or_argument(opnum::opnumbase* op)
+        {
+            if (dynamic_cast<opnum::global*>(op))
+                return true;
+            auto* r = dynamic_cast<opnum::reg*>(op);
+            return r && r->is_bp_offset() && r->get_bp_offset() > 0;
+        }
+        static bool _may_be_ref(const pure_value_analyze_context& ctx, opnum::opnumbase* op)
+        {
+            if (auto* r = dynamic_cast<opnum::reg*>(op))
+            {
+                if (!r->is_tmp_regist() && !r->is_bp_offset())
+                    return true;
+            }
+            return _is_global_or_argument(op) || _is_in_operands(ctx.ref_slots, op);
+        }
+        bool _is_cr_read_as_value_after(const pure_value_analyze_context& ctx, size_t ip)
+        {
+            // Check commands after pure value, cr should be read as value until it is overwritten.
+            for (size_t i = ip; i < ctx.end && i < ip + 8; ++i)
+            {
+                if (i != ip && ctx.tagged_ips.find(i) != ctx.tagged_ips.end())
+                    return false;
+
+                auto& cmd = ir_command_buffer[i];
+                switch (cmd.opcode)
+                {
+                case instruct::calln:
+                case instruct::call:
+                case instruct::jt:
+                case instruct::jf:
+                case instruct::equb:
+                case instruct::nequb:
+                case instruct::equx:
+                case instruct::nequx:
+                case instruct::lti:
+                case instruct::gti:
+                case instruct::elti:
+                case instruct::egti:
+                case instruct::ltx:
+                case instruct::gtx:
+                case instruct::eltx:
+                case instruct::egtx:
+                case instruct::ltr:
+                case instruct::gtr:
+                case instruct::eltr:
+                case instruct::egtr:
+                case instruct::land:
+                case instruct::lor:
+                    return true;
+                case instruct::set:
+                case instruct::setcast:
+                    if (_is_reg(cmd.op1, opnum::reg::cr))
+                        return !_is_reg(cmd.op2, opnum::reg::cr);
+                    continue;
+                case instruct::psh:
+                    continue;
+                case instruct::mov:
+                case instruct::movcast:
+                case instruct::addi:
+                case instruct::subi:
+                case instruct::muli:
+                case instruct::divi:
+                case instruct::modi:
+                case instruct::addr:
+                case instruct::subr:
+                case instruct::mulr:
+                case instruct::divr:
+                case instruct::modr:
+                case instruct::addh:
+                case instruct::subh:
+                case instruct::adds:
+                    if (_is_reg(cmd.op1, opnum::reg::cr))
+                        return false;
+                    continue;
+                default:
+                    return false;
+                }
+            }
+            return false;
+        }
+        bool _is_pure_value_available(const pure_value_analyze_context& ctx, const pure_value& pv, size_t from, size_t to)
+        {
+            for (auto* operand : pv.operands)
+                if (_is_in_operands(ctx.escaped_slots, operand))
+                    return false;
+
+            bool has_global_or_argument_operand = false;
+            for (auto* operand : pv.operands)
+                has_global_or_argument_operand = has_global_or_argument_operand || _is_global_or_argument(operand);
+
+            for (size_t i = from; i < to; ++i)
+            {
+                auto& cmd = ir_command_buffer[i];
+
+                bool through_ref = false;
+                auto* written = _get_written_operand(cmd, &through_ref);
+                if (written && _is_in_operands(pv.operands, written))
+                    return false;
+
+                if (_is_impure_call(cmd)
+                    || cmd.opcode == instruct::idx // Indexing map might insert.
+                    || (written && through_ref && _may_be_ref(ctx, written)))
+                {
+                    // Anything might be changed.
+                    if (pv.read_referred || (has_global_or_argument_operand && !pv.immutable_operands))
+                        return false;
+                }
+            }
+            return true;
+        }
+        void _collect_tag_names(const ir_command& cmd, cxx_vec_t<std::string>* out_names)
+        {
+            // calln's op1 is the native function, see 'call'.
+            if (cmd.opcode != instruct::calln)
+            {
+                if (auto* t = dynamic_cast<opnum::tag*>(cmd.op1))
+                    out_names->push_back(t->name);
+                else if (auto* tt = dynamic_cast<opnum::tag_table*>(cmd.op1))
+                    out_names->insert(out_names->end(), tt->names.begin(), tt->names.end());
+            }
+            if (auto* t = dynamic_cast<opnum::tag*>(cmd.op2))
+                out_names->push_back(t->name);
+        }
+        bool _prepare_pure_value_analyze_context(pure_value_analyze_context* ctx)
+        {
+            for (auto fnd = tag_irbuffer_offset.lower_bound(ctx->begin); fnd != tag_irbuffer_offset.end(); ++fnd)
+            {
+                ctx->tagged_ips.insert(fnd->first);
+                for (auto& tagname : fnd->second)
+                    ctx->tag_ips[tagname] = fnd->first;
+            }
+
+            for (size_t i = ctx->begin; i < ctx->end; ++i)
+            {
+                auto& cmd = ir_command_buffer[i];
+                if (cmd.opcode == instruct::lds || cmd.opcode == instruct::ldsr)
+                    // Stack value might be accessed by offset, give up.
+                    return false;
+
+                if (cmd.opcode == instruct::idstruct || cmd.opcode == instruct::popr)
+                    ctx->ref_slots.push_back(cmd.op1);
+                else if (cmd.opcode == instruct::pshr)
+                    ctx->escaped_slots.push_back(cmd.op1);
+                else if (cmd.opcode == instruct::ext
+                    && cmd.ext_page_id == 0
+                    && (cmd.ext_opcode_p0 == instruct::extern_opcode_page_0::setref
+                        || cmd.ext_opcode_p0 == instruct::extern_opcode_page_0::trans))
+                {
+                    ctx->ref_slots.push_back(cmd.op1);
+                    ctx->escaped_slots.push_back(cmd.op2);
+                }
+            }
+
+            auto is_tagged = [ctx](size_t ip) {return ctx->tagged_ips.find(ip) != ctx->tagged_ips.end(); };
+            for (size_t i = ctx->begin; i < ctx->end; ++i)
+            {
+                auto& cmd = ir_command_buffer[i];
+                if (cmd.opcode == instruct::calln && (cmd.pure_call_flags & PURE_CALL))
+                {
+                    if (i + 1 >= ctx->end
+                        || is_tagged(i + 1)
+                        || ir_command_buffer[i + 1].opcode != instruct::pop
+                        || ir_command_buffer[i + 1].op1 != nullptr)
+                        continue;
+
+                    pure_value pv;
+                    pv.end = i + 2;
+                    pv.immutable_operands = cmd.pure_call_flags & PURE_CALL_IMMUTABLE_ARGS;
+                    pv.read_referred = cmd.pure_call_flags & PURE_CALL_READ_REFERRED;
+                    pv.using_tc = false;
+
+                    size_t argc = (size_t)ir_command_buffer[i + 1].opinteger;
+                    size_t args_end = i;
+                    if (args_end > ctx->begin
+                        && ir_command_buffer[args_end - 1].opcode == instruct::set
+                        && _is_reg(ir_command_buffer[args_end - 1].op1, opnum::reg::tc)
+                        && dynamic_cast<opnum::immbase*>(ir_command_buffer[args_end - 1].op2))
+                    {
+                        pv.using_tc = true;
+                        --args_end;
+                    }
+                    if (args_end < ctx->begin + argc)
+                        continue;
+
+                    pv.begin = args_end - argc;
+                    bool is_pure_value = true;
+                    for (size_t argi = pv.begin; argi < args_end; ++argi)
+                    {
+                        auto& arg_cmd = ir_command_buffer[argi];
+                        if (arg_cmd.opcode != instruct::psh
+                            || !_is_pure_value_operand(arg_cmd.op1)
+                            || (argi != pv.begin && is_tagged(argi)))
+                        {
+                            is_pure_value = false;
+                            break;
+                        }
+                        pv.operands.push_back(arg_cmd.op1);
+                    }
+                    if (is_pure_value && (args_end == pv.begin || !is_tagged(args_end)) && (args_end == i || !is_tagged(i)))
+                        ctx->pure_values.emplace_back(std::move(pv));
+                }
+                else if (cmd.opcode == instruct::idstruct
+                    && _is_reg(cmd.op1, opnum::reg::cr)
+                    && _is_pure_value_operand(cmd.op2))
+                {
+                    pure_value pv;
+                    pv.begin = i;
+                    pv.end = i + 1;
+                    pv.operands.push_back(cmd.op2);
+                    pv.immutable_operands = false;
+                    pv.read_referred = true;
+                    pv.using_tc = false;
+
+                    while (pv.end < ctx->end
+                        && !is_tagged(pv.end)
+                        && ir_command_buffer[pv.end].opcode == instruct::idstruct
+                        && _is_reg(ir_command_buffer[pv.end].op1, opnum::reg::cr)
+                        && _is_reg(ir_command_buffer[pv.end].op2, opnum::reg::cr))
+                        ++pv.end;
+
+                    if (_is_cr_read_as_value_after(*ctx, pv.end))
+                        ctx->pure_values.emplace_back(std::move(pv));
+                    i = pv.end - 1;
+                }
+            }
+            std::sort(ctx->pure_values.begin(), ctx->pure_values.end(),
+                [](const pure_value& a, const pure_value& b) {return a.begin < b.begin; });
+            return true;
+        }
+        bool _is_same_pure_value(const pure_value& a, const pure_value& b)
+        {
+            if (a.end - a.begin != b.end - b.begin)
+                return false;
+            for (size_t i = 0; i < a.end - a.begin; ++i)
+                if (!_is_same_command(ir_command_buffer[a.begin + i], ir_command_buffer[b.begin + i]))
+                    return false;
+            return true;
+        }
+        opnum::reg* _get_unused_temp_register(size_t begin, size_t end)
+        {
+            std::set<uint8_t> used_regs;
+            for (size_t i = begin; i < end; ++i)
+            {
+                auto& cmd = ir_command_buffer[i];
+                if (cmd.opcode != instruct::calln)
+                    if (auto* r = dynamic_cast<opnum::reg*>(cmd.op1))
+                        used_regs.insert(r->id);
+                if (auto* r = dynamic_cast<opnum::reg*>(cmd.op2))
+                    used_regs.insert(r->id);
+            }
+            for (uint8_t id = opnum::reg::t0; id <= opnum::reg::r15; ++id)
+                if (used_regs.find(id) == used_regs.end())
+                    return _created_opnum_item(opnum::reg(id));
+            return nullptr;
+        }
+        bool _hoist_loop_invariant_pure_value(const pure_value_analyze_context& ctx, cxx_vec_t<ir_edit>* out_edits)
+        {
+            // Loop: tag loop_begin; ...; jmp loop_begin;
+            //  Pure values in the first block of loop, which will be evaluated in each loop, can be
+            //  moved before loop if they will not be changed in loop.
+            for (size_t loop_end = ctx.begin; loop_end < ctx.end; ++loop_end)
+            {
+                auto& jmp_cmd = ir_command_buffer[loop_end];
+                if (jmp_cmd.opcode != instruct::jmp)
+                    continue;
+
+                auto& loop_tag = dynamic_cast<opnum::tag*>(jmp_cmd.op1)->name;
+                auto fnd_loop_begin = ctx.tag_ips.find(loop_tag);
+                if (fnd_loop_begin == ctx.tag_ips.end() || fnd_loop_begin->second > loop_end)
+                    continue;
+
+                const size_t loop_begin = fnd_loop_begin->second;
+
+                // Loop can only be entered from loop_begin.
+                bool enter_from_begin_only = true;
+                for (size_t i = ctx.begin; i < ctx.end && enter_from_begin_only; ++i)
+                {
+                    if (i >= loop_begin && i <= loop_end)
+                        continue;
+
+                    cxx_vec_t<std::string> jmp_aims;
+                    _collect_tag_names(ir_command_buffer[i], &jmp_aims);
+                    for (auto& aim : jmp_aims)
+                    {
+                        auto fnd = ctx.tag_ips.find(aim);
+                        if (aim == loop_tag
+                            || (fnd != ctx.tag_ips.end() && fnd->second > loop_begin && fnd->second <= loop_end))
+                        {
+                            enter_from_begin_only = false;
+                            break;
+                        }
+                    }
+                }
+                if (!enter_from_begin_only)
+                    continue;
+
+                size_t first_block_end = loop_begin;
+                while (first_block_end <= loop_end
+                    && (first_block_end == loop_begin || ctx.tagged_ips.find(first_block_end) == ctx.tagged_ips.end())
+                    && !_is_end_of_block(ir_command_buffer[first_block_end]))
+                    ++first_block_end;
+
+                for (auto& pv : ctx.pure_values)
+                {
+                    if (pv.begin < loop_begin || pv.end > first_block_end
+                        || !_is_pure_value_available(ctx, pv, loop_begin, loop_end + 1))
+                        continue;
+
+                    auto* result_reg = _get_unused_temp_register(ctx.begin, ctx.end);
+                    if (result_reg == nullptr)
+                        return false;
+
+                    auto* cr = _created_opnum_item(opnum::reg(opnum::reg::cr));
+                    auto* tc = _created_opnum_item(opnum::reg(opnum::reg::tc));
+
+                    ir_edit hoist_edit = {};
+                    hoist_edit.ip = loop_begin;
+                    hoist_edit.moved_tag = loop_tag;
+                    if (pv.using_tc)
+                        hoist_edit.hoisted.push_back(ir_command{ instruct::psh, tc });
+                    hoist_edit.hoisted.insert(hoist_edit.hoisted.end(),
+                        ir_command_buffer.begin() + pv.begin, ir_command_buffer.begin() + pv.end);
+                    if (pv.using_tc)
+                        hoist_edit.hoisted.push_back(ir_command{ instruct::pop, tc });
+                    hoist_edit.hoisted.push_back(ir_command{ instruct::set, result_reg, cr });
+
+                    ir_edit replace_edit = {};
+                    replace_edit.ip = pv.begin;
+                    replace_edit.erase_count = pv.end - pv.begin;
+                    replace_edit.replaced.push_back(ir_command{ instruct::set, cr, result_reg });
+
+                    if (pv.begin == loop_begin)
+                    {
+                        hoist_edit.erase_count = replace_edit.erase_count;
+                        hoist_edit.replaced = std::move(replace_edit.replaced);
+                        out_edits->emplace_back(std::move(hoist_edit));
+                    }
+                    else
+                    {
+                        out_edits->emplace_back(std::move(hoist_edit));
+                        out_edits->emplace_back(std::move(replace_edit));
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+        bool _reuse_common_pure_value(const pure_value_analyze_context& ctx, cxx_vec_t<ir_edit>* out_edits)
+        {
+            // Same pure values in same block, the later one can reuse the result of former one.
+            for (size_t a = 0; a < ctx.pure_values.size(); ++a)
+            {
+                auto& former = ctx.pure_values[a];
+
+                size_t block_end = former.begin + 1;
+                while (block_end < ctx.end
+                    && ctx.tagged_ips.find(block_end) == ctx.tagged_ips.end()
+                    && !_is_end_of_block(ir_command_buffer[block_end - 1]))
+                    ++block_end;
+
+                for (size_t b = a + 1; b < ctx.pure_values.size(); ++b)
+                {
+                    auto& later = ctx.pure_values[b];
+                    if (later.end > block_end)
+                        break;
+
+                    if (!_is_same_pure_value(former, later)
+                        || !_is_pure_value_available(ctx, former, former.end, later.begin))
+                        continue;
+
+                    ir_edit replace_edit = {};
+                    replace_edit.ip = later.begin;
+                    replace_edit.erase_count = later.end - later.begin;
+
+                    if (former.end != later.begin)
+                    {
+                        // Or the result is still in cr.
+                        auto* result_reg = _get_unused_temp_register(ctx.begin, ctx.end);
+                        if (result_reg == nullptr)
+                            return false;
+
+                        auto* cr = _created_opnum_item(opnum::reg(opnum::reg::cr));
+
+                        ir_edit store_edit = {};
+                        store_edit.ip = former.end;
+                        store_edit.replaced.push_back(ir_command{ instruct::set, result_reg, cr });
+                        out_edits->emplace_back(std::move(store_edit));
+
+                        replace_edit.replaced.push_back(ir_command{ instruct::set, cr, result_reg });
+                    }
+                    out_edits->emplace_back(std::move(replace_edit));
+                    return true;
+                }
+            }
+            return false;
+        }
+        void _apply_ir_edits(size_t begin, const cxx_vec_t<ir_edit>& edits, std::vector<size_t>* out_ip_mapping)
+        {
+            const size_t end = get_now_ip();
+
+            cxx_vec_t<ir_command> updated_commands;
+            std::map<std::string, size_t> moved_tags;
+            out_ip_mapping->resize(end - begin + 1);
+
+            auto edit = edits.begin();
+            for (size_t ip = begin; ip <= end;)
+            {
+                (*out_ip_mapping)[ip - begin] = begin + updated_commands.size();
+
+                size_t erase_count = 0;
+                if (edit != edits.end() && edit->ip == ip)
+                {
+                    updated_commands.insert(updated_commands.end(), edit->hoisted.begin(), edit->hoisted.end());
+                    if (!edit->moved_tag.empty())
+                        moved_tags[edit->moved_tag] = begin + updated_commands.size();
+                    updated_commands.insert(updated_commands.end(), edit->replaced.begin(), edit->replaced.end());
+                    erase_count = edit->erase_count;
+                    ++edit;
+                }
+                if (ip == end)
+                    break;
+
+                if (erase_count)
+                {
+                    for (size_t i = 1; i < erase_count; ++i)
+                        (*out_ip_mapping)[ip + i - begin] = begin + updated_commands.size();
+                    ip += erase_count;
+                }
+                else
+                    updated_commands.push_back(ir_command_buffer[ip++]);
+            }
+            wo_assert(edit == edits.end());
+
+            ir_command_buffer.resize(begin);
+            ir_command_buffer.insert(ir_command_buffer.end(), updated_commands.begin(), updated_commands.end());
+
+            std::map<size_t, cxx_vec_t<std::string>> updated_tags;
+            for (auto fnd = tag_irbuffer_offset.lower_bound(begin); fnd != tag_irbuffer_offset.end();)
+            {
+                for (auto& tagname : fnd->second)
+                {
+                    if (auto fnd_moved = moved_tags.find(tagname); fnd_moved != moved_tags.end())
+                        updated_tags[fnd_moved->second].push_back(tagname);
+                    else
+                        updated_tags[(*out_ip_mapping)[fnd->first - begin]].push_back(tagname);
+                }
+                fnd = tag_irbuffer_offset.erase(fnd);
+            }
+            for (auto& [ip, tagnames] : updated_tags)
+                tag_irbuffer_offset[ip] = std::move(tagnames);
+        }
+    public:
+        // Move loop-invariant pure values out of loop and reuse the common pure values in same
+        // block, for the commands generated from begin (which belong to one function).
+        void optimize_pure_values(size_t begin)
+        {
+            const size_t origin_end = get_now_ip();
+
+            std::vector<size_t> origin_ip_mapping;
+            for (size_t ip = begin; ip <= origin_end; ++ip)
+                origin_ip_mapping.push_back(ip);
+
+            bool updated = false;
+            for (size_t optimized_count = 0; optimized_count < 256; ++optimized_count)
+            {
+                pure_value_analyze_context ctx;
+                ctx.begin = begin;
+                ctx.end = get_now_ip();
+                if (!_prepare_pure_value_analyze_context(&ctx) || ctx.pure_values.empty())
+                    break;
+
+                cxx_vec_t<ir_edit> edits;
+                if (!_hoist_loop_invariant_pure_value(ctx, &edits)
+                    && !_reuse_common_pure_value(ctx, &edits))
+                    break;
+
+                std::sort(edits.begin(), edits.end(),
+                    [](const ir_edit& a, const ir_edit& b) {return a.ip < b.ip; });
+
+                std::vector<size_t> ip_mapping;
+                _apply_ir_edits(begin, edits, &ip_mapping);
+                for (auto& ip : origin_ip_mapping)
+                    ip = ip_mapping[ip - begin];
+
+                updated = true;
+            }
+
+            if (updated)
+            {
+                for (auto& [filename, rowbuf] : pdb_info->_general_src_data_buf_a)
+                    for (auto& [rowno, colbuf] : rowbuf)
+                        for (auto& [colno, ip] : colbuf)
+                            if (ip >= begin && ip <= origin_end)
+                                ip = origin_ip_mapping[ip - begin];
+            }
+        }
+
 
 #define WO_PUT_IR_TO_BUFFER(OPCODE, ...) ir_command_buffer.emplace_back(ir_command{OPCODE, __VA_ARGS__});
 
@@ -1397,6 +2110,15 @@ namespace wo
             codeb.ext_opcode_p0 = instruct::extern_opcode_page_0::veh;
         }
 
+        void ext_jmptab(const opnum::tag_table& op1)
+        {
+            wo_assert(op1.names.size() <= UINT16_MAX);
+
+            auto& codeb = WO_PUT_IR_TO_BUFFER(instruct::opcode::ext, WO_OPNUM(op1));
+            codeb.ext_page_id = 0;
+            codeb.ext_opcode_p0 = instruct::extern_opcode_page_0::jmptab;
+        }
+
         template<typename OP1T>
         void ext_mkunion(const OP1T& op1, uint16_t id)
         {
@@ -1405,6 +2127,33 @@ namespace wo
             codeb.ext_opcode_p0 = instruct::extern_opcode_page_0::mkunion;
         }
 
+        template<typename OP1T, typename OP2T>
+        void ext_idarr(const OP1T& op1, const OP2T& op2)
+        {
+            static_assert(std::is_base_of<opnum::opnumbase, OP1T>::value
+                && std::is_base_of<opnum::opnumbase, OP2T>::value,
+                "Argument(s) should be opnum.");
+
+            auto& codeb = WO_PUT_IR_TO_BUFFER(instruct::opcode::ext, WO_OPNUM(op1), WO_OPNUM(op2));
+            codeb.ext_page_id = 0;
+            codeb.ext_opcode_p0 = instruct::extern_opcode_page_0::idarr;
+        }
+
+        template<typename OP1T, typename OP2T>
+        void ext_nextarr(const OP1T& op1, const OP2T& op2)
+        {
+            static_assert(std::is_base_of<opnum::opnumbase, OP1T>::value
+                && std::is_base_of<opnum::opnumbase, OP2T>::value,
+                "Argument(s) should be opnum.");
+
+            static_assert(!std::is_base_of<opnum::immbase, OP2T>::value,
+                "Can not set value to immediate.");
+
+            auto& codeb = WO_PUT_IR_TO_BUFFER(instruct::opcode::ext, WO_OPNUM(op1), WO_OPNUM(op2));
+            codeb.ext_page_id = 0;
+            codeb.ext_opcode_p0 = instruct::extern_opcode_page_0::nextarr;
+        }
+
         template<typename OP1T, typename OP2T>
         void mkarr(const OP1T& op1, const OP2T& op2)
         {
@@ -2215,6 +2964,40 @@ namespace wo
                             temp_this_command_code_buf.push_back(readptr[1]);
                             break;
                         }
+                        case instruct::extern_opcode_page_0::idarr:
+                            temp_this_command_code_buf.push_back(WO_OPCODE_EXT0(idarr));
+                            auto_check_mem_allign(2, WO_IR.op1->generate_opnum_to_buffer(temp_this_command_code_buf));
+                            auto_check_mem_allign(2, WO_IR.op2->generate_opnum_to_buffer(temp_this_command_code_buf));
+                            break;
+                        case instruct::extern_opcode_page_0::nextarr:
+                            temp_this_command_code_buf.push_back(WO_OPCODE_EXT0(nextarr));
+                            auto_check_mem_allign(2, WO_IR.op1->generate_opnum_to_buffer(temp_this_command_code_buf));
+                            auto_check_mem_allign(2, WO_IR.op2->generate_opnum_to_buffer(temp_this_command_code_buf));
+                            break;
+                        case instruct::extern_opcode_page_0::jmptab:
+                        {
+                            auto* table = dynamic_cast<opnum::tag_table*>(WO_IR.op1);
+                            wo_assert(table != nullptr, "Operator num should be a tag table.");
+
+                            temp_this_command_code_buf.push_back(WO_OPCODE_EXT0(jmptab, 00));
+                            auto_check_mem_allign(2, 2);
+                            uint16_t count = (uint16_t)table->names.size();
+                            byte_t* readptr = (byte_t*)&count;
+                            temp_this_command_code_buf.push_back(readptr[0]);
+                            temp_this_command_code_buf.push_back(readptr[1]);
+
+                            auto_check_mem_allign(2, 4);
+                            for (size_t i = 0; i < table->names.size(); ++i)
+                            {
+                                jmp_record_table[table->names[i]]
+                                    .push_back(generated_runtime_code_buf.size() + need_fill_count + 2 + 2 + 4 * i);
+                                temp_this_command_code_buf.push_back(0x00);
+                                temp_this_command_code_buf.push_back(0x00);
+                                temp_this_command_code_buf.push_back(0x00);
+                                temp_this_command_code_buf.push_back(0x00);
+                            }
+                            break;
+                        }
                         default:
                             wo_error("Unknown instruct.");
                             break;
@@ -4,14 +4,27 @@
 
 #include <shared_mutex>
 #include <atomic>
+#include <chrono>
 
 
 namespace wo
 {
+    struct gcheap;
+
     namespace gc
     {
         void gc_start();
+        // Called by vm received MEMORY_QUOTA_INTERRUPT, wait for the full gc confirming exceeding of
+        // the heap, return true if live bytes still exceed the quota after it.
+        bool gc_confirm_memory_quota(gcheap* heap);
+#ifdef WO_SINGLE_THREADED
+        // GC works in vm's thread, vm will never run while marking.
+        constexpr bool gc_is_marking() { return false; }
+        // Collect in current thread, called by vm received GC_INTERRUPT, see flush_thread_allocated_bytes.
+        void gc_work_at_safepoint();
+#else
         bool gc_is_marking();
+#endif
     }
 
     template<typename NodeT>
@@ -28,6 +41,16 @@ namespace wo
             } while (!last_node.compare_exchange_weak(last_last_node, node));
         }
 
+        // Add nodes linked from 'head' to 'tail' (by 'last') at once.
+        void add_list(NodeT* head, NodeT* tail)
+        {
+            NodeT* last_last_node = last_node;
+            do
+            {
+                tail->last = last_last_node;
+            } while (!last_node.compare_exchange_weak(last_last_node, head));
+        }
+
         NodeT* pick_all()
         {
             NodeT* result = nullptr;
@@ -38,46 +61,172 @@ namespace wo
     };
 
     struct value;
+    struct gcbase;
 
-    struct gcbase
+    // Gcunits are allocated in the heap of the vm which is running in current thread. Isolated heap
+    // is collected separately, only vms of the heap will be paused, see config::ENABLE_GC_ISOLATED_HEAP.
+    // The default heap(id = 0) is collected with all vms paused, and units of all heaps are traced.
+    struct gcheap
     {
-        inline static atomic_list<gcbase> eden_age_gcunit_list;
-        inline static atomic_list<gcbase> young_age_gcunit_list;
-        inline static atomic_list<gcbase> old_age_gcunit_list;
+        const uint16_t m_id;
+
+        atomic_list<gcbase> m_eden_gcunit_list;
+        atomic_list<gcbase> m_young_gcunit_list;
+        atomic_list<gcbase> m_old_gcunit_list;
+        // Units holding large buffers, regarded as old units, see config::GC_LARGE_OBJECT_SIZE.
+        atomic_list<gcbase> m_large_gcunit_list;
+
+        // Bytes of gcunits allocated, gc-thread will reduce it when collecting.
+        std::atomic_size_t m_new_bytes = 0;
+        // Bytes of units & buffers of their containers which are not freed, counted by threads
+        // allocating & freeing them, might be negative for a while before all threads flushed.
+        std::atomic_int64_t m_live_bytes = 0;
+        // Bytes allocated since last gc to trigger gc, will be adjusted by gc::_gc_adjust_edges
+        std::atomic_size_t m_immediately_edge = 0;
+        std::atomic_size_t m_stop_the_world_edge = 0;
+
+        // Count of vms using this heap, heap will be merged into default heap when no vm use it.
+        std::atomic_size_t m_alive_vm_count = 0;
+
+        // Vm allocating in this heap will fail if m_live_bytes exceeds it, 0 means no limit.
+        // Exceeding is confirmed after a full gc of the heap, see gc::gc_confirm_memory_quota.
+        std::atomic_size_t m_memory_quota = 0;
+        std::atomic_size_t m_started_collect_count = 0;
+        std::atomic_size_t m_finished_collect_count = 0;
+        // Collection started after this count will confirm exceeding, 0 means not exceeded.
+        std::atomic_size_t m_quota_checking_count = 0;
+
+        // Following members are only used by gc-thread.
+        size_t m_allocated_bytes_before_work = 0;
+        std::chrono::steady_clock::time_point m_last_work_end_time = std::chrono::steady_clock::now();
+        double m_last_allocate_rate = 0.;
+        size_t m_old_count_after_full_collect = 0;
+        size_t m_promoted_count_since_full_collect = 0;
+        size_t m_old_bytes = 0;
+        size_t m_large_count_after_full_collect = 0;
+        size_t m_large_count_since_full_collect = 0;
+
+        gcheap(uint16_t id)
+            : m_id(id)
+        {
+        }
+
+        gcheap(const gcheap&) = delete;
+        gcheap(gcheap&&) = delete;
+        gcheap& operator=(const gcheap&) = delete;
+        gcheap& operator=(gcheap&&) = delete;
+
+        static gcheap default_heap;
 
-        // TODO : _shared_spin need to remake.
+        // nullptr means default heap.
+        inline static thread_local gcheap* thread_heap = nullptr;
+        static gcheap* switch_thread_heap(gcheap* heap);
+
+        // Return nullptr if no more heap can be created, then default heap should be used.
+        static gcheap* create();
+        static void add_vm(gcheap* heap);
+        static void remove_vm(gcheap* heap);
+
+        struct thread_heap_guard
+        {
+            gcheap* _last_heap;
+            inline thread_heap_guard(gcheap* heap)
+                : _last_heap(switch_thread_heap(heap))
+            {
+            }
+            inline ~thread_heap_guard()
+            {
+                switch_thread_heap(_last_heap);
+            }
+        };
+    };
+    inline gcheap gcheap::default_heap{ 0 };
+
+    struct gcbase
+    {
+        // Eden gcunits of default heap are registered in the list of the thread which created them,
+        // gc-thread will merge all of them when collecting, see pick_all_eden_gcunits.
+        inline static thread_local atomic_list<gcbase>* thread_eden_gcunit_list = nullptr;
+        static atomic_list<gcbase>* register_thread_eden_gcunit_list();
+        static gcbase* pick_all_eden_gcunits();
+
+        // Writer holds the lock by making the version odd, and makes it even (increased) again
+        // when unlocking, so optimistic readers can validate what they read without writing
+        // to the lock, see read_begin & read_validate.
         struct _shared_spin
         {
-            std::atomic_flag _sspin_write_flag = {};
-            std::atomic_uint _sspin_read_flag = {};
+            std::atomic_uint32_t _sspin_version = {};
+            std::atomic_uint32_t _sspin_read_flag = {};
 
             inline void lock() noexcept
             {
-                while (_sspin_write_flag.test_and_set());
+                uint32_t version = _sspin_version.load();
+                do
+                {
+                    while (version & 1)
+                        version = _sspin_version.load();
+                } while (!_sspin_version.compare_exchange_weak(version, version + 1));
+
                 while (_sspin_read_flag);
             }
             inline void unlock() noexcept
             {
-                _sspin_write_flag.clear();
+                _sspin_version.fetch_add(1);
             }
             inline void lock_shared() noexcept
             {
-                while (_sspin_write_flag.test_and_set());
-                _sspin_read_flag.fetch_add(1);
-                _sspin_write_flag.clear();
+                do
+                {
+                    const uint32_t version = _sspin_version.load();
+                    if (version & 1)
+                        continue;
+
+                    _sspin_read_flag.fetch_add(1);
+
+                    // Writer might lock before reader registered, check again.
+                    if (_sspin_version.load() == version)
+                        break;
+
+                    _sspin_read_flag.fetch_sub(1);
+                } while (true);
             }
             inline void unlock_shared() noexcept
             {
                 _sspin_read_flag.fetch_sub(1);
             }
+            inline uint32_t read_begin() const noexcept
+            {
+                uint32_t version;
+                while ((version = _sspin_version.load(std::memory_order_acquire)) & 1);
+                return version;
+            }
+            inline bool read_validate(uint32_t version) const noexcept
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return _sspin_version.load(std::memory_order_relaxed) == version;
+            }
         };
 
+        // Only one thread works with gcunits in single-threaded build, units need no lock.
+        struct _no_lock
+        {
+            inline void lock() noexcept {}
+            inline void unlock() noexcept {}
+            inline void lock_shared() noexcept {}
+            inline void unlock_shared() noexcept {}
+            inline uint32_t read_begin() const noexcept { return 0; }
+            inline bool read_validate(uint32_t) const noexcept { return true; }
+        };
+
+        // NOTE: Reference of values in container might be given out by read guard too,
+        //       so both read & write guard will remember old container for minor gc.
         struct gc_read_guard
         {
             gcbase* _mx;
             inline gc_read_guard(gcbase* sp)
                 :_mx(sp)
             {
+                _mx->gc_remember();
                 _mx->read();
             }
             inline ~gc_read_guard()
@@ -86,12 +235,45 @@ namespace wo
             }
         };
 
+        // Used by gc-markers, donot remember the container.
+        struct gc_mark_read_guard
+        {
+            gcbase* _mx;
+            inline gc_mark_read_guard(gcbase* sp)
+                :_mx(sp)
+            {
+                _mx->read();
+            }
+            inline ~gc_mark_read_guard()
+            {
+                _mx->read_end();
+            }
+        };
+
+        // Optimistic read for concurrent readers, nothing will be written to the unit. 'func' will
+        // be retried if writer modified the unit meanwhile, so it should only read buffers which
+        // will not be freed before the unit (struct & closure), and only into locals, values read
+        // might be torn before validated.
+        template<typename FuncT>
+        inline static void gc_optimistic_read(gcbase* unit, FuncT&& func)
+        {
+            unit->gc_remember();
+            do
+            {
+                const uint32_t version = unit->gc_read_write_mx.read_begin();
+                func();
+                if (unit->gc_read_write_mx.read_validate(version))
+                    break;
+            } while (true);
+        }
+
         struct gc_write_guard
         {
             gcbase* _mx;
             inline gc_write_guard(gcbase* sp)
                 :_mx(sp)
             {
+                _mx->gc_remember();
                 _mx->write();
             }
             inline ~gc_write_guard()
@@ -114,11 +296,45 @@ namespace wo
             self_mark,
             full_mark,
         };
+        // Type of the gcunit, used for tracing & destructing without rtti.
+        enum class gcunittype : uint8_t
+        {
+            string,
+            array,
+            mapping,
+            gchandle,
+            closure,
+            structure,
+        };
 
         gctype gc_type = gctype::no_gc;
         gcmarkcolor gc_mark_color = gcmarkcolor::no_mark;
+        gcunittype gc_unit_type;
+        uint8_t gc_size_class = slab::LARGE_SIZE_CLASS;
         uint16_t gc_mark_version = 0;
         uint16_t gc_mark_alive_count = 0;
+        std::atomic_bool gc_remembered = false;
+        uint16_t gc_heap_id = 0;
+
+        // Old units which might hold young units, will be traced in minor gc.
+        static void add_remembered_gcunit(gcbase* unit);
+
+        // Write barrier for minor gc: old container which is (or might be) modified
+        // should be remembered, to make sure young units in it will be marked.
+        // Container of other heap modified by vm of isolated heap is remembered too, it
+        // will be traced when collecting the isolated heap, see gc::gc_mark_unit_as_black.
+        inline void gc_remember()
+        {
+            if (gc_type == gctype::old
+                || (gcheap::thread_heap != nullptr && gcheap::thread_heap->m_id != gc_heap_id))
+                gc_remember_anyway();
+        }
+        inline void gc_remember_anyway()
+        {
+            if (!gc_remembered.load(std::memory_order_relaxed)
+                && !gc_remembered.exchange(true))
+                add_remembered_gcunit(this);
+        }
 
         inline void gc_mark(uint16_t version, gcmarkcolor color)
         {
@@ -156,7 +372,12 @@ namespace wo
         }
 
         using rw_lock = _shared_spin;
-        rw_lock gc_read_write_mx;
+#ifdef WO_SINGLE_THREADED
+        using unit_rw_lock = _no_lock;
+#else
+        using unit_rw_lock = _shared_spin;
+#endif
+        unit_rw_lock gc_read_write_mx;
         inline void write()
         {
             gc_read_write_mx.lock();
@@ -177,45 +398,98 @@ namespace wo
         // used in linklist;
         gcbase* last = nullptr;
 
-        struct memo_unit
+        // Write barrier used while gc marking: record the unit of 'val' which is read from (or
+        // removed from) this container, so it will be marked even if it is moved to somewhere else.
+        // Units are recorded in thread-local buffer, see gc::_gc_satb_buffer.
+        void add_memo(const value* val);
+
+        // Destruct the gcunit by it's gc_unit_type, defined in wo_basic_type.hpp
+        inline void gc_destruct();
+        // Destruct the gcunit and give it's memory back to slab allocator.
+        inline static void gc_delete(gcbase* unit);
+        // Bytes of the gcunit & buffers of it's container, defined in wo_basic_type.hpp
+        inline size_t gc_size();
+        // Bytes counted when allocating & sweeping the gcunit, buffers allocated by gc_allocator
+        // are counted by the allocator, defined in wo_basic_type.hpp
+        inline size_t gc_self_size();
+        // Units holding large buffers will be moved to large-object space, defined in wo_basic_type.hpp
+        inline bool gc_is_large_object();
+
+        // Allocated bytes are counted by thread at first, and will be added to gcheap::m_new_bytes when
+        // more than THREAD_ALLOCATED_BYTES_FLUSH_SIZE, gc-thread will be notified if budget exhausted.
+        static constexpr size_t THREAD_ALLOCATED_BYTES_FLUSH_SIZE = 16 * 1024;
+        inline static thread_local size_t thread_allocated_bytes = 0;
+        // Freed bytes are only added to gcheap::m_live_bytes, gc-markers sweeping units count
+        // them into the collecting heap.
+        inline static thread_local size_t thread_freed_bytes = 0;
+        static void flush_thread_allocated_bytes();
+
+        inline static void gc_count_allocated_bytes(size_t bytes)
         {
-            gcbase* gcunit;
-            memo_unit* last;
-        };
+            thread_allocated_bytes += bytes;
+            if (thread_allocated_bytes >= THREAD_ALLOCATED_BYTES_FLUSH_SIZE)
+                flush_thread_allocated_bytes();
+        }
+        inline static void gc_count_freed_bytes(size_t bytes)
+        {
+            thread_freed_bytes += bytes;
+            if (thread_freed_bytes >= THREAD_ALLOCATED_BYTES_FLUSH_SIZE)
+                flush_thread_allocated_bytes();
+        }
+    };
+
+    // Allocator of containers' buffer held by gcunits, allocated & freed bytes are counted into the
+    // heap of current thread. Large buffers will be allocated in large-object space, see los::allocator.
+    template<typename T>
+    struct gc_allocator
+    {
+        using value_type = T;
 
-        std::atomic<memo_unit*> m_memo = nullptr;
+        gc_allocator() noexcept = default;
+        template<typename U>
+        gc_allocator(const gc_allocator<U>&) noexcept {}
 
-        memo_unit* pick_memo()
+        T* allocate(size_t n)
         {
-            return m_memo.exchange(nullptr);
+            T* ptr = los::allocator<T>().allocate(n);
+            gcbase::gc_count_allocated_bytes(n * sizeof(T));
+            return ptr;
         }
-        void add_memo(const value* val);
-
-        virtual ~gcbase() 
+        void deallocate(T* ptr, size_t n) noexcept
         {
-            auto memoptr = pick_memo();
-            while (memoptr)
-            {
-                auto* curmemo = memoptr;
-                memoptr = memoptr->last;
-
-                delete curmemo;
-            }
-        };
+            los::allocator<T>().deallocate(ptr, n);
+            gcbase::gc_count_freed_bytes(n * sizeof(T));
+        }
 
-        inline static std::atomic_uint32_t gc_new_count = 0;
+        template<typename U>
+        bool operator == (const gc_allocator<U>&) const noexcept { return true; }
+        template<typename U>
+        bool operator != (const gc_allocator<U>&) const noexcept { return false; }
     };
 
+    // Every type managed by gcunit should specialize this to give it's gcunittype.
+    template<typename T>
+    struct gcunit_type_tag;
+
     template<typename T>
     struct gcunit : public gcbase, public T
     {
         template<gcbase::gctype AllocType, typename ... ArgTs >
         static gcunit<T>* gc_new(gcbase*& write_aim, ArgTs && ... args)
         {
-            ++gc_new_count;
+            constexpr uint8_t size_class = slab::size_class_of(sizeof(gcunit<T>));
 
-            auto* created_gcnuit = new (alloc64(sizeof(gcunit<T>)))gcunit<T>(args...);
+            auto* created_gcnuit = new (slab::alloc(sizeof(gcunit<T>), size_class))gcunit<T>(args...);
             created_gcnuit->gc_type = AllocType;
+            created_gcnuit->gc_size_class = size_class;
+
+            gc_count_allocated_bytes(created_gcnuit->gc_self_size());
+
+            gcheap* heap = gcheap::thread_heap;
+            if (heap != nullptr)
+                created_gcnuit->gc_heap_id = heap->m_id;
+            else
+                heap = &gcheap::default_heap;
 
             *reinterpret_cast<std::atomic<gcbase*>*>(&write_aim) = created_gcnuit;
 
@@ -225,13 +499,20 @@ namespace wo
                 /* DO NOTHING */
                 break;
             case wo::gcbase::gctype::eden:
-                eden_age_gcunit_list.add_one(created_gcnuit);
+                if (heap != &gcheap::default_heap)
+                    heap->m_eden_gcunit_list.add_one(created_gcnuit);
+                else
+                {
+                    if (thread_eden_gcunit_list == nullptr)
+                        register_thread_eden_gcunit_list();
+                    thread_eden_gcunit_list->add_one(created_gcnuit);
+                }
                 break;
             case wo::gcbase::gctype::young:
-                young_age_gcunit_list.add_one(created_gcnuit);
+                heap->m_young_gcunit_list.add_one(created_gcnuit);
                 break;
             case wo::gcbase::gctype::old:
-                old_age_gcunit_list.add_one(created_gcnuit);
+                heap->m_old_gcunit_list.add_one(created_gcnuit);
                 break;
             default:
                 // wo_error("Unknown gc type.");
@@ -244,7 +525,7 @@ namespace wo
         template<typename ... ArgTs>
         gcunit(ArgTs && ... args) : T(args...)
         {
-
+            gc_unit_type = gcunit_type_tag<T>::value;
         }
 
         template<typename TT>
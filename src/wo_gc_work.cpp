@@ -4,7 +4,9 @@
 
 #include <thread>
 #include <chrono>
+#include <algorithm>
 #include<list>
+#include <deque>
 
 // PARALLEL-GC SUPPORT:
 /*
@@ -21,19 +23,61 @@ GC will do following work to instead of old-gc:
 
 namespace wo
 {
-    void gcbase::add_memo(const value* val)
+    struct _gc_thread_eden_gcunit_list
     {
-        // TODO: IF HAS BEEN FULL-MAKRED, SKIP MEMORY OPERATION
-        if (auto* mem = val->get_gcunit_with_barrier())
+        atomic_list<gcbase> m_list;
+
+        inline static std::mutex _registed_lists_mx;
+        inline static std::vector<_gc_thread_eden_gcunit_list*> _registed_lists;
+
+        _gc_thread_eden_gcunit_list()
+        {
+            std::lock_guard g1(_registed_lists_mx);
+            _registed_lists.push_back(this);
+        }
+        ~_gc_thread_eden_gcunit_list()
         {
-            memo_unit* last_memo = m_memo;
-            memo_unit* new_memo = new memo_unit{ mem, nullptr };
             do
             {
-                new_memo->last = last_memo;
+                std::lock_guard g1(_registed_lists_mx);
+                _registed_lists.erase(
+                    std::find(_registed_lists.begin(), _registed_lists.end(), this));
+            } while (0);
+
+            // Thread exited, give remained units to global eden list.
+            auto* unit = m_list.pick_all();
+            while (unit)
+            {
+                auto* last = unit->last;
+                gcheap::default_heap.m_eden_gcunit_list.add_one(unit);
+                unit = last;
+            }
+            gcbase::thread_eden_gcunit_list = nullptr;
+        }
+    };
+
+    atomic_list<gcbase>* gcbase::register_thread_eden_gcunit_list()
+    {
+        thread_local _gc_thread_eden_gcunit_list list;
+        return thread_eden_gcunit_list = &list.m_list;
+    }
+    gcbase* gcbase::pick_all_eden_gcunits()
+    {
+        gcbase* result = gcheap::default_heap.m_eden_gcunit_list.pick_all();
 
-            } while (!m_memo.compare_exchange_weak(last_memo, new_memo));
+        std::lock_guard g1(_gc_thread_eden_gcunit_list::_registed_lists_mx);
+        for (auto* thread_list : _gc_thread_eden_gcunit_list::_registed_lists)
+        {
+            if (auto* picked = thread_list->m_list.pick_all())
+            {
+                auto* tail = picked;
+                while (tail->last)
+                    tail = tail->last;
+                tail->last = result;
+                result = picked;
+            }
         }
+        return result;
     }
 
     // A very simply GC system, just stop the vm, then collect inform
@@ -41,7 +85,7 @@ namespace wo
     namespace gc
     {
         uint16_t                    _gc_round_count = 0;
-        constexpr uint16_t          _gc_work_thread_count = 4;
+        size_t                      _gc_work_thread_count = 0; // Decided in gc_start
         constexpr uint16_t          _gc_max_count_to_move_young_to_old = 5;
 
         std::atomic_bool            _gc_stop_flag = false;
@@ -51,20 +95,90 @@ namespace wo
 
         std::atomic_flag            _gc_immediately = {};
 
-        uint32_t                    _gc_immediately_edge = 50000;
-        uint32_t                    _gc_stop_the_world_edge = _gc_immediately_edge * 5;
+        // Set when allocating thread notified gc-thread, make sure gc-thread will be notified only once.
+        std::atomic_bool            _gc_budget_exhausted_notified = false;
+
+        // Isolated heaps, heaps without vm will be merged into default heap by gc-thread.
+        std::mutex                  _gc_isolated_heaps_mx;
+        std::vector<gcheap*>        _gc_isolated_heaps;
+        std::vector<uint16_t>       _gc_free_heap_ids;
+        uint16_t                    _gc_next_heap_id = 1;
+
+        // Heap collecting now, nullptr means default heap, all heaps will be traced.
+        gcheap*                     _gc_collecting_heap = nullptr;
+        uint16_t                    _gc_collecting_heap_id = 0;
 
         std::atomic_size_t _gc_scan_vm_index;
         volatile size_t _gc_scan_vm_count;
         vmbase** volatile _gc_vm_list;
 
-        volatile bool _gc_is_marking = false;
+        std::atomic_bool _gc_is_marking = false;
         volatile bool _gc_stopping_world_gc = false;
 
+        // Minor gc only marks & collects eden/young units, old units will be regarded as alive,
+        // young units referenced by old units are found by remembered units.
+        bool _gc_is_minor_collecting = false;
+        bool _gc_full_collect_requested = false;
+
+        // Round confirming memory quota also frees unmarked eden units, so garbage allocated just
+        // before exceeding will not be regarded alive, see gc_confirm_memory_quota.
+        bool _gc_is_confirming_quota = false;
+        std::mutex _gc_quota_mx;
+        std::condition_variable _gc_quota_cv;
+        constexpr size_t _gc_min_promoted_count_to_full_collect = 4096;
+
+        std::mutex _gc_remembered_units_mx;
+        std::vector<gcbase*> _gc_remembered_units;
+
+        // Remembered units of last round of their heap, used by gc-thread only. Ref given out
+        // before the pause (by idx, etc.) might be written through after container traced, so
+        // they are traced again in next round, see _gc_push_remembered_units_as_gray.
+        std::vector<gcbase*> _gc_last_remembered_units;
+
+        // Statistics of gc, updated after each gc round, see wo_gc_get_stats.
+        std::mutex                  _gc_stats_mx;
+        wo_gc_stats                 _gc_stats = {};
+        std::atomic<wo_gc_stats_callback> _gc_stats_callback = nullptr;
+        std::atomic_size_t          _gc_satb_recorded_count = 0;
+
+        // Heap snapshot requested by wo_gc_dump_heap_snapshot, will be written in next gc round.
+        std::mutex                  _gc_snapshot_request_mx;
+        std::mutex                  _gc_snapshot_mx;
+        std::condition_variable     _gc_snapshot_cv;
+        bool                        _gc_snapshot_requested = false;
+        bool                        _gc_snapshot_finished = false;
+        bool                        _gc_snapshot_result = false;
+        std::string                 _gc_snapshot_path;
+
+        // Dead gchandles are closed & freed by finalizer threads, so slow destructors will not
+        // extend gc rounds, see config::GC_FINALIZER_THREAD_COUNT.
+        std::mutex                  _gc_finalizer_mx;
+        std::condition_variable     _gc_finalizer_cv;
+        std::deque<gchandle_t*>     _gc_finalizing_handles;
+        std::vector<std::thread>    _gc_finalizer_threads;
+        bool                        _gc_finalizer_stop_flag = false;
+        std::atomic_size_t          _gc_finalizer_backlog_count = 0;
+        std::atomic_size_t          _gc_finalized_count = 0;
+
+        // Full gc will be requested when alive prompt gchandles exceed the edge, see
+        // gc_handle_base_t::set_prompt & config::GC_PROMPT_HANDLE_LIMIT.
+        std::atomic_size_t          _gc_prompt_handle_edge = 0;
+        std::atomic_bool            _gc_prompt_collect_requested = false;
+        std::atomic_size_t          _gc_prompt_handle_marked_count = 0;
+
+        // Gchandles holding gcunit, holding units are marked by gc until the gchandle closed, so
+        // they are alive when destructor called even if the unit is shared by other gchandles.
+        atomic_list<gc_handle_base_t> _gc_holding_handles;
+
+        // Locked by gc-thread from marking end to weak slots cleared, see _gc_clear_weak_slots.
+        std::shared_mutex           _gc_weak_slots_mx;
+
+#ifndef WO_SINGLE_THREADED
         bool gc_is_marking()
         {
             return _gc_is_marking;
         }
+#endif
 
         vmbase* _get_next_mark_vm(vmbase::vm_type* out_vm_type)
         {
@@ -78,345 +192,1535 @@ namespace wo
             return nullptr;
         }
 
-        std::list<gcbase*> _gc_gray_unit_lists[_gc_work_thread_count];
-
-        void gc_mark_unit_as_gray(size_t workerid, gcbase* unit)
+        // Chase-Lev work-stealing deque, the owner marker push & pop gray units at bottom,
+        // other markers steal from top when they have nothing to do.
+        class _gc_mark_deque
         {
-            if (unit->gc_marked(_gc_round_count) == gcbase::gcmarkcolor::no_mark)
+            struct _unit_buffer
             {
-                unit->gc_mark(_gc_round_count, gcbase::gcmarkcolor::self_mark);
-
-                // TODO: Optmize here, donot use new.
-                _gc_gray_unit_lists[workerid].push_back(unit);
-            }
-        }
+                const int64_t m_capacity;
+                std::atomic<gcbase*>* m_units;
 
-        void gc_mark_unit_as_black(size_t workerid, gcbase* unit)
-        {
-            // TODO: Make 'gc_mark' atomicable
-            if (unit->gc_marked(_gc_round_count) == gcbase::gcmarkcolor::full_mark)
-                return;
+                _unit_buffer(int64_t capacity)
+                    : m_capacity(capacity)
+                    , m_units(new std::atomic<gcbase*>[capacity])
+                {
+                    wo_assert((capacity & (capacity - 1)) == 0);
+                }
+                ~_unit_buffer()
+                {
+                    delete[] m_units;
+                }
+                gcbase* get(int64_t index) const
+                {
+                    return m_units[index & (m_capacity - 1)].load(std::memory_order_relaxed);
+                }
+                void put(int64_t index, gcbase* unit)
+                {
+                    m_units[index & (m_capacity - 1)].store(unit, std::memory_order_relaxed);
+                }
+            };
 
-            unit->gc_mark(_gc_round_count, gcbase::gcmarkcolor::full_mark);
+            std::atomic_int64_t m_top = 0;
+            std::atomic_int64_t m_bottom = 0;
+            std::atomic<_unit_buffer*> m_buffer = new _unit_buffer(1024);
 
-            wo::gcbase::gc_read_guard g1(unit);
+            // Buffers replaced by growing might still be read by thieves, free them between rounds.
+            std::vector<_unit_buffer*> m_retired_buffers;
 
-            gcbase::memo_unit* memo = unit->pick_memo();
-            while (memo)
+        public:
+            ~_gc_mark_deque()
             {
-                auto* curmemo = memo;
-                memo = memo->last;
+                release_retired_buffers();
+                delete m_buffer.load();
+            }
 
-                gc_mark_unit_as_gray(workerid, curmemo->gcunit);
+            void release_retired_buffers()
+            {
+                for (auto* buffer : m_retired_buffers)
+                    delete buffer;
+                m_retired_buffers.clear();
+            }
 
-                delete curmemo;
+            bool empty() const
+            {
+                return m_bottom.load(std::memory_order_acquire) <= m_top.load(std::memory_order_acquire);
             }
 
-            if (array_t* wo_arr = dynamic_cast<array_t*>(unit))
+            // Only the owner can push.
+            void push(gcbase* unit)
             {
-                for (auto& val : *wo_arr)
+                int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+                int64_t top = m_top.load(std::memory_order_acquire);
+                _unit_buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+
+                if (bottom - top > buffer->m_capacity - 1)
                 {
-                    if (gcbase* gcunit_addr = val.get_gcunit_with_barrier())
-                        gc_mark_unit_as_gray(workerid, gcunit_addr);
+                    _unit_buffer* new_buffer = new _unit_buffer(buffer->m_capacity * 2);
+                    for (int64_t i = top; i < bottom; ++i)
+                        new_buffer->put(i, buffer->get(i));
+
+                    m_retired_buffers.push_back(buffer);
+                    m_buffer.store(buffer = new_buffer, std::memory_order_release);
                 }
+                buffer->put(bottom, unit);
+                std::atomic_thread_fence(std::memory_order_release);
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
             }
-            else if (mapping_t* wo_map = dynamic_cast<mapping_t*>(unit))
+
+            // Only the owner can pop.
+            gcbase* pop()
             {
-                for (auto& [key, val] : *wo_map)
+                int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+                _unit_buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+                m_bottom.store(bottom, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int64_t top = m_top.load(std::memory_order_relaxed);
+
+                if (top > bottom)
                 {
-                    if (gcbase* gcunit_addr = key.get_gcunit_with_barrier())
-                        gc_mark_unit_as_gray(workerid, gcunit_addr);
-                    if (gcbase* gcunit_addr = val.get_gcunit_with_barrier())
-                        gc_mark_unit_as_gray(workerid, gcunit_addr);
+                    // Empty.
+                    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                    return nullptr;
                 }
-            }
-            else if (gchandle_t* wo_gchandle = dynamic_cast<gchandle_t*>(unit))
-            {
-                if (gcbase* gcunit_addr = wo_gchandle->holding_value.get_gcunit_with_barrier())
-                    gc_mark_unit_as_gray(workerid, gcunit_addr);
-            }
-            else if (closure_t* wo_closure = dynamic_cast<closure_t*>(unit))
-            {
-                for (auto& captured : wo_closure->m_closure_args)
+
+                gcbase* unit = buffer->get(bottom);
+                if (top == bottom)
                 {
-                    if (gcbase* gcunit_addr = captured.get_gcunit_with_barrier())
-                        gc_mark_unit_as_gray(workerid, gcunit_addr);
+                    // Last one, race with thieves.
+                    if (!m_top.compare_exchange_strong(top, top + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed))
+                        unit = nullptr;
+                    m_bottom.store(bottom + 1, std::memory_order_relaxed);
                 }
+                return unit;
             }
-            else if (struct_t* wo_struct = dynamic_cast<struct_t*>(unit))
+
+            gcbase* steal()
             {
-                for (uint16_t i = 0; i < wo_struct->m_count; ++i)
-                    if (gcbase* gcunit_addr = wo_struct->m_values[i].get_gcunit_with_barrier())
-                        gc_mark_unit_as_gray(workerid, gcunit_addr);
+                int64_t top = m_top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+                if (top < bottom)
+                {
+                    gcbase* unit = m_buffer.load(std::memory_order_acquire)->get(top);
+                    if (m_top.compare_exchange_strong(top, top + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed))
+                        return unit;
+                }
+                return nullptr;
             }
-        }
+        };
 
-        class _gc_mark_thread_groups
-        {
-            std::thread _m_gc_mark_threads[_gc_work_thread_count];
-            std::atomic_flag _m_gc_begin_flags[_gc_work_thread_count];
+        std::unique_ptr<_gc_mark_deque[]> _gc_gray_unit_deques;
 
-            std::mutex _m_gc_begin_mx;
-            std::condition_variable _m_gc_begin_cv;
+        // Count of markers which cannot find any gray unit in full-mark round.
+        std::atomic_size_t _gc_idle_marker_count;
 
-            std::mutex _m_gc_end_mx;
-            std::condition_variable _m_gc_end_cv;
-            std::atomic_size_t _m_gc_mark_end_count;
+        void gc_mark_unit_as_gray(size_t workerid, gcbase* unit)
+        {
+            // Units of other isolated heaps cannot be referenced by collecting heap.
+            if (_gc_collecting_heap_id != 0
+                && unit->gc_heap_id != 0
+                && unit->gc_heap_id != _gc_collecting_heap_id)
+                return;
 
-            std::atomic_bool _m_worker_enabled;
+            if (_gc_is_minor_collecting && unit->gc_type == gcbase::gctype::old)
+                return;
 
-            static void _gcmarker_thread_work(_gc_mark_thread_groups* self, size_t worker_id)
+            if (unit->gc_marked(_gc_round_count) == gcbase::gcmarkcolor::no_mark)
             {
-#ifdef WO_PLATRORM_OS_WINDOWS
-                SetThreadDescription(GetCurrentThread(), L"wo_gc_marker");
-#endif
-                do
-                {
-                    do
-                    {
-                        std::unique_lock ug1(self->_m_gc_begin_mx);
-                        self->_m_gc_begin_cv.wait(ug1, [&]()->bool {
-                            return !self->_m_gc_begin_flags[worker_id].test_and_set()
-                                || !self->_m_worker_enabled;
-                            });
-                        if (!self->_m_worker_enabled)
-                            return;
+                unit->gc_mark(_gc_round_count, gcbase::gcmarkcolor::self_mark);
+                _gc_gray_unit_deques[workerid].push(unit);
+            }
+        }
 
-                    } while (false);
+        // SATB (snapshot-at-the-beginning) write barrier buffers:
+        // Units recorded by gcbase::add_memo are stored in fixed-size buffer of each thread,
+        // when the buffer is full, all units in it will be flushed to _gc_satb_flushed_units
+        // for markers; remained units will be flushed by gc-thread after marking.
+        constexpr size_t _GC_SATB_BUFFER_SIZE = 256;
 
-                    vmbase* marking_vm = nullptr;
-                    vmbase::vm_type vm_type;
-                    while ((marking_vm = _get_next_mark_vm(&vm_type)))
-                    {
-                        if (auto env = marking_vm->env)
-                        {
-                            if (vm_type == vmbase::vm_type::GC_DESTRUCTOR)
-                            {
-                                // Any code context only have one GC_DESTRUCTOR, here to mark global space.
-                                for (size_t cgr_index = 0;
-                                    cgr_index < env->constant_and_global_value_takeplace_count;
-                                    cgr_index++)
-                                {
-                                    auto global_val = env->constant_global_reg_rtstack + cgr_index;
-
-                                    gcbase* gcunit_address = global_val->get_gcunit_with_barrier();
-                                    if (gcunit_address)
-                                        gc_mark_unit_as_gray(worker_id, gcunit_address);
-                                }
-                            }
-                            else
-                            {
-                                wo_assert(vm_type == vmbase::vm_type::NORMAL);
-                                // Mark stack, reg, 
-
-                                // walk thorgh regs.
-                                for (size_t reg_index = 0;
-                                    reg_index < env->real_register_count;
-                                    reg_index++)
-                                {
-                                    auto self_reg_walker = marking_vm->register_mem_begin + reg_index;
-
-                                    gcbase* gcunit_address = self_reg_walker->get_gcunit_with_barrier();
-                                    if (gcunit_address)
-                                        gc_mark_unit_as_gray(worker_id, gcunit_address);
-
-                                }
-
-                                // walk thorgh stack.
-                                for (auto* stack_walker = marking_vm->stack_mem_begin/*env->stack_begin*/;
-                                    marking_vm->sp < stack_walker;
-                                    stack_walker--)
-                                {
-                                    auto stack_val = stack_walker;
-
-                                    gcbase* gcunit_address = stack_val->get_gcunit_with_barrier();
-                                    if (gcunit_address)
-                                        gc_mark_unit_as_gray(worker_id, gcunit_address);
-                                }
-                            }
-                        }
-                    }
+        std::mutex                  _gc_satb_flushed_units_mx;
+        std::vector<gcbase*>        _gc_satb_flushed_units;
+        std::atomic_size_t          _gc_satb_flushed_unit_count = 0;
 
-                    if (_gc_work_thread_count == ++self->_m_gc_mark_end_count)
-                    {
-                        // All mark thread end, notify..
-                        std::lock_guard g1(self->_m_gc_end_mx);
-                        self->_m_gc_end_cv.notify_all();
-                    }
-                    ////////////////////////////////////////////////////////////////
-                    // Do gc fullmark here
-                    do
-                    {
-                        std::unique_lock ug1(self->_m_gc_begin_mx);
-                        self->_m_gc_begin_cv.wait(ug1, [&]()->bool {
-                            return !self->_m_gc_begin_flags[worker_id].test_and_set()
-                                || !self->_m_worker_enabled;
-                            });
-                        if (!self->_m_worker_enabled)
-                            return;
+        void _gc_satb_flush_units(gcbase** units, size_t count)
+        {
+            std::lock_guard g1(_gc_satb_flushed_units_mx);
+            _gc_satb_flushed_units.insert(_gc_satb_flushed_units.end(), units, units + count);
+            _gc_satb_flushed_unit_count += count;
+            _gc_satb_recorded_count += count;
+        }
 
-                    } while (false);
+        struct _gc_satb_buffer
+        {
+            gcbase* m_units[_GC_SATB_BUFFER_SIZE];
+            size_t m_count = 0;
 
-                    std::list<gcbase*> graylist;
-                    while (!_gc_gray_unit_lists[worker_id].empty())
-                    {
-                        graylist.clear();
-                        graylist.swap(_gc_gray_unit_lists[worker_id]);
-                        for (auto* markingunit : graylist)
-                        {
-                            gc_mark_unit_as_black(worker_id, markingunit);
-                        }
-                    }
+            // Owner thread & gc-thread might access the buffer at same time.
+            std::atomic_flag m_spin = {};
 
-                    if (_gc_work_thread_count == ++self->_m_gc_mark_end_count)
-                    {
-                        // All mark thread end, notify..
-                        std::lock_guard g1(self->_m_gc_end_mx);
-                        self->_m_gc_end_cv.notify_all();
-                    }
+            inline static std::mutex _registed_buffers_mx;
+            inline static std::vector<_gc_satb_buffer*> _registed_buffers;
 
-                } while (true);
-            }
-        public:
-            _gc_mark_thread_groups()
+            void lock()
             {
-                start();
-            }
-            ~_gc_mark_thread_groups()
-            {
-                stop();
+                while (m_spin.test_and_set(std::memory_order_acquire));
             }
-            static _gc_mark_thread_groups& instancce()
+            void unlock()
             {
-                static _gc_mark_thread_groups g;
-                return g;
+                m_spin.clear(std::memory_order_release);
             }
-        public:
-            void stop()
-            {
-                if (_m_worker_enabled)
-                {
-                    std::lock_guard g1(_m_gc_begin_mx);
-                    _m_worker_enabled = false;
-                    _m_gc_begin_cv.notify_all();
-                }
 
-                for (size_t id = 0; id < _gc_work_thread_count; ++id)
-                    _m_gc_mark_threads[id].join();
-            }
-            void start()
+            void record(gcbase* unit)
             {
-                if (!_m_worker_enabled)
+                lock();
+                // Check again, units recorded after marking will never be marked.
+                if (_gc_is_marking)
                 {
-                    _m_worker_enabled = true;
-                    for (size_t id = 0; id < _gc_work_thread_count; ++id)
+                    m_units[m_count++] = unit;
+                    if (m_count == _GC_SATB_BUFFER_SIZE)
                     {
-                        _m_gc_begin_flags[id].test_and_set(); // make sure gcmarkers donot work at begin.
-                        _m_gc_mark_threads[id] = std::move(std::thread(_gcmarker_thread_work, this, id));
+                        _gc_satb_flush_units(m_units, m_count);
+                        m_count = 0;
                     }
                 }
+                unlock();
             }
 
-            void launch_round_of_mark()
+            // Return flushed unit count.
+            size_t flush()
             {
-                _m_gc_mark_end_count = 0;
-                do
+                lock();
+                const size_t count = m_count;
+                if (count != 0)
                 {
-                    std::lock_guard g1(_m_gc_begin_mx);
-                    for (size_t id = 0; id < _gc_work_thread_count; ++id)
-                        _m_gc_begin_flags[id].clear();
-
-                    _m_gc_begin_cv.notify_all();
-                } while (false);
+                    _gc_satb_flush_units(m_units, count);
+                    m_count = 0;
+                }
+                unlock();
+                return count;
+            }
 
+            _gc_satb_buffer()
+            {
+                std::lock_guard g1(_registed_buffers_mx);
+                _registed_buffers.push_back(this);
+            }
+            ~_gc_satb_buffer()
+            {
+                std::lock_guard g1(_registed_buffers_mx);
+                _registed_buffers.erase(
+                    std::find(_registed_buffers.begin(), _registed_buffers.end(), this));
 
-                do
-                {
-                    std::unique_lock ug1(_m_gc_end_mx);
-                    _m_gc_end_cv.wait(ug1, [this]() {return _m_gc_mark_end_count == _gc_work_thread_count; });
-                } while (false);
+                if (_gc_is_marking)
+                    flush();
             }
         };
 
-        void mark_nogc_child(gcbase* picked_list, size_t worker_id)
+        void gc_record_satb_unit(gcbase* unit)
         {
-            while (picked_list)
+            thread_local _gc_satb_buffer buffer;
+            buffer.record(unit);
+        }
+
+        size_t gc_flush_all_satb_buffers()
+        {
+            size_t count = 0;
+            std::lock_guard g1(_gc_satb_buffer::_registed_buffers_mx);
+            for (auto* buffer : _gc_satb_buffer::_registed_buffers)
+                count += buffer->flush();
+            return count;
+        }
+
+        // Mark all flushed units as gray, return false if no unit flushed.
+        bool gc_drain_satb_units(size_t workerid)
+        {
+            if (_gc_satb_flushed_unit_count == 0)
+                return false;
+
+            std::vector<gcbase*> units;
+            do
             {
-                if (picked_list->gc_type == gcbase::gctype::no_gc
-                    && gcbase::gcmarkcolor::no_mark == picked_list->gc_marked(_gc_round_count))
-                    gc_mark_unit_as_gray(worker_id, picked_list);
+                std::lock_guard g1(_gc_satb_flushed_units_mx);
+                units.swap(_gc_satb_flushed_units);
+                _gc_satb_flushed_unit_count = 0;
+            } while (0);
 
-                picked_list = picked_list->last;
+            for (auto* unit : units)
+                gc_mark_unit_as_gray(workerid, unit);
+
+            return !units.empty();
+        }
+
+        gcbase* gc_steal_gray_unit(size_t workerid)
+        {
+            for (size_t i = 1; i < _gc_work_thread_count; ++i)
+            {
+                if (gcbase* unit = _gc_gray_unit_deques[(workerid + i) % _gc_work_thread_count].steal())
+                    return unit;
             }
+            return nullptr;
         }
 
-        void check_and_move_edge_to_edge(gcbase* picked_list,
-            wo::atomic_list<wo::gcbase>* origin_list,
-            wo::atomic_list<wo::gcbase>* aim_edge,
-            wo::gcbase::gctype aim_gc_type,
-            uint16_t max_count)
+        bool gc_has_gray_unit()
         {
-            while (picked_list)
+            for (size_t i = 0; i < _gc_work_thread_count; ++i)
             {
-                auto* last = picked_list->last;
+                if (!_gc_gray_unit_deques[i].empty())
+                    return true;
+            }
+            return _gc_satb_flushed_unit_count != 0;
+        }
 
-                if (picked_list->gc_type != gcbase::gctype::no_gc &&
-                    picked_list->gc_type != gcbase::gctype::eden &&
-                    gcbase::gcmarkcolor::no_mark == picked_list->gc_marked(_gc_round_count))
-                {
-                    // was not marked, delete it
-                    // TODO: is map? if is map check it if need gc_destruct?
+        enum class _gc_root_kind : uint8_t
+        {
+            global,
+            register_,
+            stack,
+        };
 
-                    picked_list->~gcbase();
-                    free64(picked_list);
+        // Walk through all gcunits in vm's stack, register, or global space(only in GC_DESTRUCTOR vm).
+        template<typename FuncT>
+        void _gc_for_each_root(vmbase* vm, vmbase::vm_type vm_type, FuncT&& func)
+        {
+            auto env = vm->env;
+            if (!env)
+                return;
 
-                } // ~
-                else
+            if (vm_type == vmbase::vm_type::GC_DESTRUCTOR)
+            {
+                // Any code context only have one GC_DESTRUCTOR, here to mark global space.
+                for (size_t cgr_index = 0;
+                    cgr_index < env->constant_and_global_value_takeplace_count;
+                    cgr_index++)
                 {
-                    //ATTENTION: A BUG CAUSED BY OVERWRITE NO_GC FLAG
-                    //
-                    // In gchandle, guard_value will be set aas 'no_gc' to make sure it destruct after
-                    // gchandle, but in here, we overwrite gc_type, it will make guard_value destruct before
-                    // gchandle in once gc-work.
-                    // in this situation, gchandle destruct, and reset guard_value's gc-type. but memory has
-                    // been reused. this written operation will write to wrong place.
-                    //
+                    auto global_val = env->constant_global_reg_rtstack + cgr_index;
 
-                    if (!origin_list || ((picked_list->gc_type == gcbase::gctype::eden
-                        || picked_list->gc_mark_alive_count > max_count) && aim_edge))
-                    {
-                        // gcbase::gc_write_guard gcwg1(picked_list);
-
-                        // over count, move it to old_edge.
-                        aim_edge->add_one(picked_list);
+                    gcbase* gcunit_address = global_val->get_gcunit_with_barrier();
+                    if (gcunit_address)
+                        func(_gc_root_kind::global, cgr_index, gcunit_address);
+                }
+            }
+            else
+            {
+                wo_assert(vm_type == vmbase::vm_type::NORMAL);
+                // Mark stack, reg, 
 
-                        // DONOT OVERWRITE NO_GC FLAG!
-                        if (picked_list->gc_type != gcbase::gctype::no_gc)
-                            picked_list->gc_type = aim_gc_type;
-                    }
-                    else
-                    {
-                        // gcbase::gc_write_guard gcwg1(picked_list);
+                // walk thorgh regs.
+                for (size_t reg_index = 0;
+                    reg_index < env->real_register_count;
+                    reg_index++)
+                {
+                    auto self_reg_walker = vm->register_mem_begin + reg_index;
 
-                        // add it back
-                        origin_list->add_one(picked_list);
+                    gcbase* gcunit_address = self_reg_walker->get_gcunit_with_barrier();
+                    if (gcunit_address)
+                        func(_gc_root_kind::register_, reg_index, gcunit_address);
 
-                        // DONOT OVERWRITE NO_GC FLAG!
-                        if (picked_list->gc_type != gcbase::gctype::no_gc)
-                            picked_list->gc_type = aim_gc_type;
-                    }
                 }
 
-                picked_list = last;
-            }
+                // walk thorgh stack.
+                for (auto* stack_walker = vm->stack_mem_begin/*env->stack_begin*/;
+                    vm->sp < stack_walker;
+                    stack_walker--)
+                {
+                    auto stack_val = stack_walker;
+
+                    gcbase* gcunit_address = stack_val->get_gcunit_with_barrier();
+                    if (gcunit_address)
+                        func(_gc_root_kind::stack, (size_t)(vm->stack_mem_begin - stack_walker), gcunit_address);
+                }
+            }
+        }
+
+        // Walk through all gcunits held by unit, marker & heap snapshot share this traversal.
+        // Vms whose stack slots remain to be scanned after world resumed, see vmbase::gc_stack_watermark.
+        std::mutex _gc_pending_stack_vms_mx;
+        std::vector<vmbase*> _gc_pending_stack_vms;
+        std::chrono::steady_clock::time_point _gc_root_scan_deadline;
+        constexpr size_t _GC_STACK_SCAN_CHUNK_SIZE = 4096;
+
+        // Frame can run if slots below the returned address are scanned, arguments of frame are
+        // placed in caller's frame, so caller's locals will be scanned too.
+        value* _gc_frame_scan_bound(vmbase* vm, value* frame_bp)
+        {
+            value* const stack_end = vm->stack_mem_begin + 1;
+            value* const callstack = frame_bp + 1;
+
+            // Arguments of frame called by native function are placed by native, callers cannot
+            // be found, scan all of them.
+            if (callstack >= stack_end
+                || (callstack->type != value::valuetype::callstack
+                    && callstack->type != value::valuetype::barriercallstack))
+                return stack_end;
+
+            value* const caller_callstack = vm->stack_mem_begin - callstack->bp + 1;
+            if (caller_callstack <= callstack || caller_callstack > stack_end)
+                return stack_end;
+
+            return caller_callstack;
+        }
+
+        // Units held by slots in [begin, end) will be passed to func, slots referenced by refs might be
+        // overwritten before scanned, so units held by them are passed too.
+        template<typename FuncT>
+        void _gc_scan_slots(vmbase* vm, value* begin, value* end, value* unscanned_begin, FuncT&& func)
+        {
+            for (value* slot = begin; slot < end; ++slot)
+            {
+                if (gcbase* unit = slot->get_gcunit_with_barrier())
+                    func(unit);
+                else if (slot->type == value::valuetype::is_ref
+                    && slot->ref >= unscanned_begin
+                    && slot->ref <= vm->stack_mem_begin)
+                {
+                    if (gcbase* unit = slot->ref->get_gcunit_with_barrier())
+                        func(unit);
+                }
+            }
+        }
+
+        // Mark roots of vm, deep frames of normal vm will be scanned after world resumed if marking
+        // them exceeds GC_ROOT_SCAN_PAUSE_BUDGET.
+        void _gc_mark_vm_roots(vmbase* vm, vmbase::vm_type vm_type, size_t worker_id)
+        {
+            auto mark = [worker_id](gcbase* unit)
+            {
+                gc_mark_unit_as_gray(worker_id, unit);
+            };
+
+            if (vm_type != vmbase::vm_type::NORMAL || !vm->env)
+            {
+                _gc_for_each_root(vm, vm_type, [&](_gc_root_kind, size_t, gcbase* unit) { mark(unit); });
+                return;
+            }
+
+            // Jitted functions return without barrier, scan all of the stack.
+            const bool incremental =
+                config::GC_ROOT_SCAN_PAUSE_BUDGET != 0 && !config::ENABLE_JUST_IN_TIME;
+
+            value* const stack_end = vm->stack_mem_begin + 1;
+            value* scanned_end = vm->sp + 1;
+            value* frame_bp = vm->bp;
+
+            // Vm might return from native function in pause, at least 2 frames will be scanned.
+            size_t scanned_frame_count = 0;
+            while (scanned_end < stack_end)
+            {
+                value* const bound = frame_bp < vm->sp
+                    ? stack_end : _gc_frame_scan_bound(vm, frame_bp);
+                if (bound > scanned_end)
+                {
+                    _gc_scan_slots(vm, scanned_end, bound, bound, mark);
+                    scanned_end = bound;
+                }
+
+                if (scanned_end < stack_end
+                    && incremental
+                    && ++scanned_frame_count >= 2
+                    && std::chrono::steady_clock::now() > _gc_root_scan_deadline)
+                {
+                    (frame_bp + 1)->type = value::valuetype::barriercallstack;
+                    vm->gc_stack_watermark = scanned_end;
+
+                    std::lock_guard g1(_gc_pending_stack_vms_mx);
+                    _gc_pending_stack_vms.push_back(vm);
+                    break;
+                }
+                frame_bp = vm->stack_mem_begin - (frame_bp + 1)->bp;
+            }
+
+            _gc_scan_slots(vm, vm->register_mem_begin, vm->register_mem_begin + vm->env->real_register_count,
+                scanned_end, mark);
+        }
+
+        // World resumed, scan remaining slots of vms chunk by chunk, vms might scan them at same time.
+        void _gc_scan_pending_stacks()
+        {
+            std::shared_lock sg1(vmbase::_alive_vm_list_mx);
+
+            size_t marked_count = 0;
+            for (auto* vm : _gc_pending_stack_vms)
+            {
+                // Vm has been closed.
+                if (vmbase::_alive_vm_list.find(vm) == vmbase::_alive_vm_list.end())
+                    continue;
+
+                value* const stack_end = vm->stack_mem_begin + 1;
+                for (;;)
+                {
+                    std::lock_guard g1(vm->gc_stack_scan_mx);
+
+                    value* const scanned_end = vm->gc_stack_watermark;
+                    if (scanned_end == nullptr)
+                        break;
+
+                    value* const bound = std::min(scanned_end + _GC_STACK_SCAN_CHUNK_SIZE, stack_end);
+
+                    // All markers are sleeping now, gc-thread can push units to their deques.
+                    _gc_scan_slots(vm, scanned_end, bound, bound, [&marked_count](gcbase* unit)
+                        {
+                            gc_mark_unit_as_gray(marked_count++ % _gc_work_thread_count, unit);
+                        });
+                    vm->gc_stack_watermark = bound == stack_end ? nullptr : bound;
+                }
+            }
+            _gc_pending_stack_vms.clear();
+        }
+
+        template<typename FuncT>
+        void _gc_for_each_child(gcbase* unit, FuncT&& func)
+        {
+            switch (unit->gc_unit_type)
+            {
+            case gcbase::gcunittype::string:
+                // String donot hold any gcunit.
+                break;
+            case gcbase::gcunittype::array:
+            {
+                array_t* wo_arr = static_cast<array_t*>(unit);
+                for (auto& val : *wo_arr)
+                {
+                    if (gcbase* gcunit_addr = val.get_gcunit_with_barrier())
+                        func(gcunit_addr);
+                }
+                break;
+            }
+            case gcbase::gcunittype::mapping:
+            {
+                mapping_t* wo_map = static_cast<mapping_t*>(unit);
+                for (auto& [key, val] : *wo_map)
+                {
+                    if (gcbase* gcunit_addr = key.get_gcunit_with_barrier())
+                        func(gcunit_addr);
+                    if (gcbase* gcunit_addr = val.get_gcunit_with_barrier())
+                        func(gcunit_addr);
+                }
+                break;
+            }
+            case gcbase::gcunittype::gchandle:
+            {
+                gchandle_t* wo_gchandle = static_cast<gchandle_t*>(unit);
+                switch (wo_gchandle->weak)
+                {
+                case gc_handle_base_t::weak_type::not_weak:
+                    if (gcbase* gcunit_addr = wo_gchandle->holding_value.get_gcunit_with_barrier())
+                        func(gcunit_addr);
+                    break;
+                case gc_handle_base_t::weak_type::weak_value:
+                    // Weakly held unit will not be marked.
+                    break;
+                case gc_handle_base_t::weak_type::weak_keyed_map:
+                    // Only values are marked, keys are weakly held.
+                    if (!wo_gchandle->has_been_closed)
+                        for (auto& [key, val] : *static_cast<gc_handle_base_t::weak_keyed_map_t*>(wo_gchandle->holding_handle))
+                            if (gcbase* gcunit_addr = val.get_gcunit_with_barrier())
+                                func(gcunit_addr);
+                    break;
+                }
+                break;
+            }
+            case gcbase::gcunittype::closure:
+            {
+                closure_t* wo_closure = static_cast<closure_t*>(unit);
+                for (auto& captured : wo_closure->m_closure_args)
+                {
+                    if (gcbase* gcunit_addr = captured.get_gcunit_with_barrier())
+                        func(gcunit_addr);
+                }
+                break;
+            }
+            case gcbase::gcunittype::structure:
+            {
+                struct_t* wo_struct = static_cast<struct_t*>(unit);
+                for (uint16_t i = 0; i < wo_struct->m_count; ++i)
+                    if (gcbase* gcunit_addr = wo_struct->m_values[i].get_gcunit_with_barrier())
+                        func(gcunit_addr);
+                break;
+            }
+            default:
+                wo_error("Unknown gcunit type.");
+            }
+        }
+
+        void gc_mark_unit_as_black(size_t workerid, gcbase* unit)
+        {
+            // TODO: Make 'gc_mark' atomicable
+            if (unit->gc_marked(_gc_round_count) == gcbase::gcmarkcolor::full_mark)
+                return;
+
+            unit->gc_mark(_gc_round_count, gcbase::gcmarkcolor::full_mark);
+
+            wo::gcbase::gc_mark_read_guard g1(unit);
+
+            // Old unit which holds young units should be remembered for next minor gc, unit which
+            // holds units of other isolated heap should be remembered for collecting that heap.
+            const bool is_old_unit = unit->gc_type == gcbase::gctype::old;
+            bool holding_young_unit = false;
+            bool holding_isolated_unit = false;
+
+            _gc_for_each_child(unit, [&](gcbase* child)
+                {
+                    if (is_old_unit
+                        && child->gc_type != gcbase::gctype::old
+                        && child->gc_type != gcbase::gctype::no_gc)
+                        holding_young_unit = true;
+
+                    if (child->gc_heap_id != 0 && child->gc_heap_id != unit->gc_heap_id)
+                    {
+                        // Values MUST NOT be passed between vms of different isolated heaps.
+                        wo_assert(unit->gc_heap_id == 0);
+                        holding_isolated_unit = true;
+                    }
+
+                    gc_mark_unit_as_gray(workerid, child);
+                });
+
+            if (holding_young_unit || holding_isolated_unit)
+                unit->gc_remember_anyway();
+        }
+
+        struct _gc_sweep_count
+        {
+            size_t m_total_count = 0;
+            size_t m_survived_count = 0;
+            size_t m_moved_count = 0;
+            size_t m_freed_bytes = 0;
+            size_t m_survived_bytes = 0;
+            size_t m_moved_bytes = 0;
+            size_t m_large_moved_count = 0;
+            size_t m_large_moved_bytes = 0;
+        };
+
+        void _gc_add_finalizing_handles(gcbase* handles)
+        {
+            size_t count = 0;
+            do
+            {
+                std::lock_guard g1(_gc_finalizer_mx);
+                for (; handles != nullptr; handles = handles->last)
+                {
+                    _gc_finalizing_handles.push_back(static_cast<gchandle_t*>(handles));
+                    ++count;
+                }
+            } while (0);
+
+            // Finalizer threads will be notified by gc-thread after sweeping.
+            _gc_finalizer_backlog_count += count;
+        }
+
+        void _gc_finalize_handle(gchandle_t* handle)
+        {
+            // holding_value will be released in close, after destructor called.
+            handle->close();
+
+            if (handle->is_registered)
+                // Still in _gc_holding_handles, will be freed by gc-thread.
+                handle->is_finalized = true;
+            else
+                gcbase::gc_delete(handle);
+        }
+
+        // Mark holding units of gchandles which are not closed, free closed dead gchandles.
+        void _gc_scan_holding_handles()
+        {
+            gc_handle_base_t* kept_handles = nullptr, * kept_handles_tail = nullptr;
+            size_t pushed_count = 0;
+
+            gc_handle_base_t* handles = _gc_holding_handles.pick_all();
+            while (handles)
+            {
+                auto* last = handles->last;
+
+                if (handles->is_finalizing ? handles->is_finalized.load() : handles->has_been_closed)
+                {
+                    // Alive gchandle closed manually will be freed by sweeping.
+                    if (handles->is_finalizing)
+                        gcbase::gc_delete(static_cast<gchandle_t*>(handles));
+                }
+                else
+                {
+                    // All markers are sleeping now, gc-thread can push units to their deques.
+                    if (handles->weak == gc_handle_base_t::weak_type::not_weak)
+                        gc_mark_unit_as_gray(pushed_count++ % _gc_work_thread_count, handles->holding_value.gcunit);
+
+                    handles->last = kept_handles;
+                    kept_handles = handles;
+                    if (kept_handles_tail == nullptr)
+                        kept_handles_tail = handles;
+                }
+                handles = last;
+            }
+
+            if (kept_handles)
+                _gc_holding_handles.add_list(kept_handles, kept_handles_tail);
+        }
+
+        // Unit will be freed in this round, the same as sweeping.
+        bool _gc_is_unit_dead(gcbase* unit)
+        {
+            if (unit->gc_heap_id != _gc_collecting_heap_id
+                || unit->gc_type == gcbase::gctype::no_gc
+                || (unit->gc_type == gcbase::gctype::eden && !_gc_is_confirming_quota)
+                || (_gc_is_minor_collecting && unit->gc_type == gcbase::gctype::old))
+                return false;
+
+            return gcbase::gcmarkcolor::no_mark == unit->gc_marked(_gc_round_count);
+        }
+
+        // Clear weak slots which hold dead units, must be done after all units marked & before
+        // sweeping; vms cannot read weak slots now, see gc_handle_base_t::get_weak_value.
+        void _gc_clear_weak_slots()
+        {
+            gc_handle_base_t* kept_handles = nullptr, * kept_handles_tail = nullptr;
+
+            gc_handle_base_t* handles = _gc_holding_handles.pick_all();
+            while (handles)
+            {
+                auto* last = handles->last;
+
+                gchandle_t* handle_unit = static_cast<gchandle_t*>(handles);
+                if (handles->weak != gc_handle_base_t::weak_type::not_weak
+                    && !handles->is_finalizing
+                    && !_gc_is_unit_dead(handle_unit))
+                {
+                    gcbase::gc_write_guard g1(handle_unit);
+                    if (!handles->has_been_closed)
+                    {
+                        if (handles->weak == gc_handle_base_t::weak_type::weak_value)
+                        {
+                            gcbase* unit = handles->holding_value.get_gcunit_with_barrier();
+                            // Weakly held value is not counted, see rslib_std_weakref_create.
+                            if (unit != nullptr && _gc_is_unit_dead(unit))
+                                handles->holding_value.init_nil();
+                        }
+                        else
+                        {
+                            auto* weak_map = static_cast<gc_handle_base_t::weak_keyed_map_t*>(handles->holding_handle);
+                            for (auto it = weak_map->begin(); it != weak_map->end();)
+                            {
+                                gcbase* unit = it->first.get_gcunit_with_barrier();
+                                if (unit != nullptr && _gc_is_unit_dead(unit))
+                                    it = weak_map->erase(it);
+                                else
+                                    ++it;
+                            }
+                        }
+                    }
+                }
+
+                handles->last = kept_handles;
+                kept_handles = handles;
+                if (kept_handles_tail == nullptr)
+                    kept_handles_tail = handles;
+
+                handles = last;
+            }
+
+            if (kept_handles)
+                _gc_holding_handles.add_list(kept_handles, kept_handles_tail);
+        }
+
+        void _gc_finalizer_thread()
+        {
+#ifdef WO_PLATRORM_OS_WINDOWS
+            SetThreadDescription(GetCurrentThread(), L"wo_gc_finalizer");
+#endif
+            std::unique_lock ug1(_gc_finalizer_mx);
+            do
+            {
+                _gc_finalizer_cv.wait(ug1, []() {
+                    return _gc_finalizer_stop_flag || !_gc_finalizing_handles.empty(); });
+
+                // Queued handles should be closed before stopping.
+                if (_gc_finalizing_handles.empty())
+                    break;
+
+                gchandle_t* handle = _gc_finalizing_handles.front();
+                _gc_finalizing_handles.pop_front();
+
+                ug1.unlock();
+
+                _gc_finalize_handle(handle);
+
+                --_gc_finalizer_backlog_count;
+                ++_gc_finalized_count;
+
+                ug1.lock();
+
+            } while (true);
+        }
+
+#ifdef WO_SINGLE_THREADED
+        // No finalizer thread in single-threaded build, dead gchandles are closed after gc round.
+        void _gc_finalize_queued_handles()
+        {
+            std::unique_lock ug1(_gc_finalizer_mx);
+            while (!_gc_finalizing_handles.empty())
+            {
+                gchandle_t* handle = _gc_finalizing_handles.front();
+                _gc_finalizing_handles.pop_front();
+
+                ug1.unlock();
+
+                _gc_finalize_handle(handle);
+
+                --_gc_finalizer_backlog_count;
+                ++_gc_finalized_count;
+
+                ug1.lock();
+            }
+        }
+#endif
+
+        void _gc_start_finalizers()
+        {
+            wo_assert(_gc_finalizer_threads.empty());
+
+            _gc_finalizer_stop_flag = false;
+#ifdef WO_SINGLE_THREADED
+            return;
+#endif
+            for (size_t i = 0; i < config::GC_FINALIZER_THREAD_COUNT; ++i)
+                _gc_finalizer_threads.emplace_back(_gc_finalizer_thread);
+        }
+
+        void _gc_stop_finalizers()
+        {
+            do
+            {
+                std::lock_guard g1(_gc_finalizer_mx);
+                _gc_finalizer_stop_flag = true;
+                _gc_finalizer_cv.notify_all();
+            } while (0);
+
+            for (auto& finalizer : _gc_finalizer_threads)
+                finalizer.join();
+            _gc_finalizer_threads.clear();
+#ifdef WO_SINGLE_THREADED
+            _gc_finalize_queued_handles();
+#endif
+        }
+
+        void check_and_move_edge_to_edge(gcbase* picked_list,
+            wo::atomic_list<wo::gcbase>* origin_list,
+            wo::atomic_list<wo::gcbase>* aim_edge,
+            wo::gcbase::gctype aim_gc_type,
+            uint16_t max_count,
+            wo::atomic_list<wo::gcbase>* large_object_edge,
+            _gc_sweep_count* out_count)
+        {
+            _gc_sweep_count count;
+
+            // Survived units will be linked locally, then added to edges at once.
+            gcbase* moved_units = nullptr, * moved_units_tail = nullptr;
+            gcbase* kept_units = nullptr, * kept_units_tail = nullptr;
+            gcbase* large_units = nullptr, * large_units_tail = nullptr;
+            gcbase* finalizing_handles = nullptr;
+
+#ifdef WO_SINGLE_THREADED
+            // Queued handles will be closed after this round, see _gc_finalize_queued_handles.
+            constexpr bool has_finalizer = true;
+#else
+            const bool has_finalizer = !_gc_finalizer_threads.empty();
+#endif
+
+            while (picked_list)
+            {
+                auto* last = picked_list->last;
+                const size_t unit_size = picked_list->gc_size();
+                ++count.m_total_count;
+
+                // Counted gchandle being released is pinned, it will be freed in next round.
+                if (picked_list->gc_type != gcbase::gctype::no_gc &&
+                    (picked_list->gc_type != gcbase::gctype::eden || _gc_is_confirming_quota) &&
+                    gcbase::gcmarkcolor::no_mark == picked_list->gc_marked(_gc_round_count) &&
+                    (picked_list->gc_unit_type != gcbase::gcunittype::gchandle
+                        || static_cast<gchandle_t*>(picked_list)->releasing_count == 0))
+                {
+                    // was not marked, delete it
+                    // TODO: is map? if is map check it if need gc_destruct?
+
+                    count.m_freed_bytes += unit_size;
+                    // Buffers of containers are counted by gc_allocator when destructing.
+                    gcbase::gc_count_freed_bytes(picked_list->gc_self_size());
+
+                    if (picked_list->gc_unit_type == gcbase::gcunittype::gchandle
+                        && static_cast<gchandle_t*>(picked_list)->need_close())
+                    {
+                        gchandle_t* handle = static_cast<gchandle_t*>(picked_list);
+                        handle->is_finalizing = true;
+                        if (handle->is_prompt)
+                            --gc_handle_base_t::alive_prompt_count;
+
+                        if (has_finalizer)
+                        {
+                            // Dead gchandle will be closed by finalizer threads.
+                            picked_list->last = finalizing_handles;
+                            finalizing_handles = picked_list;
+                        }
+                        else
+                            _gc_finalize_handle(handle);
+                    }
+                    else
+                        gcbase::gc_delete(picked_list);
+
+                } // ~
+                else
+                {
+                    ++count.m_survived_count;
+                    count.m_survived_bytes += unit_size;
+
+                    // Handles created while collecting are not counted, or the prompt handle edge
+                    // will keep growing when creating them faster than collecting.
+                    if (picked_list->gc_unit_type == gcbase::gcunittype::gchandle
+                        && picked_list->gc_type != gcbase::gctype::eden
+                        && static_cast<gchandle_t*>(picked_list)->is_prompt
+                        && static_cast<gchandle_t*>(picked_list)->need_close())
+                        ++_gc_prompt_handle_marked_count;
+
+                    //ATTENTION: A BUG CAUSED BY OVERWRITE NO_GC FLAG
+                    //
+                    // In gchandle, guard_value will be set aas 'no_gc' to make sure it destruct after
+                    // gchandle, but in here, we overwrite gc_type, it will make guard_value destruct before
+                    // gchandle in once gc-work.
+                    // in this situation, gchandle destruct, and reset guard_value's gc-type. but memory has
+                    // been reused. this written operation will write to wrong place.
+                    //
+
+                    if (large_object_edge
+                        && picked_list->gc_type != gcbase::gctype::no_gc
+                        && picked_list->gc_is_large_object())
+                    {
+                        // Large units will not be aged any more, move them to large-object space.
+                        picked_list->last = large_units;
+                        large_units = picked_list;
+                        if (large_units_tail == nullptr)
+                            large_units_tail = picked_list;
+                        ++count.m_large_moved_count;
+                        count.m_large_moved_bytes += unit_size;
+
+                        picked_list->gc_type = gcbase::gctype::old;
+                        picked_list->gc_remember();
+                    }
+                    else if (!origin_list || ((picked_list->gc_type == gcbase::gctype::eden
+                        || picked_list->gc_mark_alive_count > max_count) && aim_edge))
+                    {
+                        // over count, move it to old_edge.
+                        picked_list->last = moved_units;
+                        moved_units = picked_list;
+                        if (moved_units_tail == nullptr)
+                            moved_units_tail = picked_list;
+                        ++count.m_moved_count;
+                        count.m_moved_bytes += unit_size;
+
+                        // DONOT OVERWRITE NO_GC FLAG!
+                        if (picked_list->gc_type != gcbase::gctype::no_gc)
+                            picked_list->gc_type = aim_gc_type;
+
+                        // Unit moved to old edge might hold young units.
+                        picked_list->gc_remember();
+                    }
+                    else
+                    {
+                        // add it back, keep it's gc_type, minor gc need to know which edge it belongs to.
+                        picked_list->last = kept_units;
+                        kept_units = picked_list;
+                        if (kept_units_tail == nullptr)
+                            kept_units_tail = picked_list;
+                    }
+                }
+
+                picked_list = last;
+            }
+
+            if (moved_units)
+                aim_edge->add_list(moved_units, moved_units_tail);
+            if (kept_units)
+                origin_list->add_list(kept_units, kept_units_tail);
+            if (large_units)
+                large_object_edge->add_list(large_units, large_units_tail);
+            if (finalizing_handles)
+                _gc_add_finalizing_handles(finalizing_handles);
+
+            *out_count = count;
+        }
+
+        // Sweeping works are split into chunks, gc-markers will take & sweep them in parallel.
+        constexpr size_t _GC_SWEEP_CHUNK_SIZE = 4096;
+
+        struct _gc_sweep_result
+        {
+            std::atomic_size_t m_total_count = 0;
+            std::atomic_size_t m_survived_count = 0;
+            std::atomic_size_t m_moved_count = 0;
+            std::atomic_size_t m_freed_bytes = 0;
+            std::atomic_size_t m_survived_bytes = 0;
+            std::atomic_size_t m_moved_bytes = 0;
+            std::atomic_size_t m_large_moved_count = 0;
+            std::atomic_size_t m_large_moved_bytes = 0;
+        };
+
+        struct _gc_sweep_chunk
+        {
+            gcbase* m_units;
+            wo::atomic_list<wo::gcbase>* m_origin_list;
+            wo::atomic_list<wo::gcbase>* m_aim_edge;
+            wo::gcbase::gctype m_aim_gc_type;
+            uint16_t m_max_count;
+            wo::atomic_list<wo::gcbase>* m_large_object_edge;
+            _gc_sweep_result* m_result;
+        };
+
+        std::vector<_gc_sweep_chunk> _gc_sweep_chunks;
+        std::atomic_size_t _gc_sweep_chunk_index = 0;
+
+        void _gc_add_sweep_chunks(gcbase* picked_list,
+            wo::atomic_list<wo::gcbase>* origin_list,
+            wo::atomic_list<wo::gcbase>* aim_edge,
+            wo::gcbase::gctype aim_gc_type,
+            uint16_t max_count,
+            wo::atomic_list<wo::gcbase>* large_object_edge,
+            _gc_sweep_result* result)
+        {
+            while (picked_list)
+            {
+                gcbase* chunk_tail = picked_list;
+                for (size_t i = 1; i < _GC_SWEEP_CHUNK_SIZE && chunk_tail->last; ++i)
+                    chunk_tail = chunk_tail->last;
+
+                gcbase* next_chunk = chunk_tail->last;
+                chunk_tail->last = nullptr;
+
+                _gc_sweep_chunks.push_back(
+                    _gc_sweep_chunk{ picked_list, origin_list, aim_edge, aim_gc_type, max_count, large_object_edge, result });
+
+                picked_list = next_chunk;
+            }
+        }
+
+        void gc_sweep_chunks()
+        {
+            size_t chunk_index;
+            while ((chunk_index = _gc_sweep_chunk_index++) < _gc_sweep_chunks.size())
+            {
+                auto& chunk = _gc_sweep_chunks[chunk_index];
+
+                _gc_sweep_count count;
+                check_and_move_edge_to_edge(chunk.m_units, chunk.m_origin_list, chunk.m_aim_edge,
+                    chunk.m_aim_gc_type, chunk.m_max_count, chunk.m_large_object_edge, &count);
+
+                chunk.m_result->m_total_count += count.m_total_count;
+                chunk.m_result->m_survived_count += count.m_survived_count;
+                chunk.m_result->m_moved_count += count.m_moved_count;
+                chunk.m_result->m_freed_bytes += count.m_freed_bytes;
+                chunk.m_result->m_survived_bytes += count.m_survived_bytes;
+                chunk.m_result->m_moved_bytes += count.m_moved_bytes;
+                chunk.m_result->m_large_moved_count += count.m_large_moved_count;
+                chunk.m_result->m_large_moved_bytes += count.m_large_moved_bytes;
+            }
+        }
+
+        // Rounds of gc-markers, launched by gc-thread in order: roots, full mark, sweep.
+        void _gc_mark_roots_round(size_t worker_id)
+        {
+            vmbase* marking_vm = nullptr;
+            vmbase::vm_type vm_type;
+            while ((marking_vm = _get_next_mark_vm(&vm_type)))
+                _gc_mark_vm_roots(marking_vm, vm_type, worker_id);
+        }
+
+        void _gc_full_mark_round(size_t worker_id)
+        {
+            do
+            {
+                while (gcbase* markingunit = _gc_gray_unit_deques[worker_id].pop())
+                    gc_mark_unit_as_black(worker_id, markingunit);
+
+                if (gcbase* stolenunit = gc_steal_gray_unit(worker_id))
+                {
+                    gc_mark_unit_as_black(worker_id, stolenunit);
+                    continue;
+                }
+
+                if (gc_drain_satb_units(worker_id))
+                    continue;
+
+                // Nothing to mark, marking will end when all markers are idle.
+                ++_gc_idle_marker_count;
+                while (_gc_idle_marker_count != _gc_work_thread_count)
+                {
+                    if (gc_has_gray_unit())
+                    {
+                        --_gc_idle_marker_count;
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+            } while (_gc_idle_marker_count != _gc_work_thread_count);
+        }
+
+        void _gc_sweep_round(size_t)
+        {
+            // Freed bytes should be counted into the heap which owns them.
+            gcheap::thread_heap_guard g1(_gc_collecting_heap);
+            gc_sweep_chunks();
+        }
+
+        class _gc_mark_thread_groups
+        {
+            std::unique_ptr<std::thread[]> _m_gc_mark_threads;
+            std::unique_ptr<std::atomic_flag[]> _m_gc_begin_flags;
+
+            std::mutex _m_gc_begin_mx;
+            std::condition_variable _m_gc_begin_cv;
+
+            std::mutex _m_gc_end_mx;
+            std::condition_variable _m_gc_end_cv;
+            std::atomic_size_t _m_gc_mark_end_count;
+
+            std::atomic_bool _m_worker_enabled;
+
+            // Round launched by gc-thread, set before gc-markers begin, see _launch_round.
+            void (*_m_round)(size_t) = nullptr;
+
+            static void _gcmarker_thread_work(_gc_mark_thread_groups* self, size_t worker_id)
+            {
+#ifdef WO_PLATRORM_OS_WINDOWS
+                SetThreadDescription(GetCurrentThread(), L"wo_gc_marker");
+#endif
+                do
+                {
+                    do
+                    {
+                        std::unique_lock ug1(self->_m_gc_begin_mx);
+                        self->_m_gc_begin_cv.wait(ug1, [&]()->bool {
+                            return !self->_m_gc_begin_flags[worker_id].test_and_set()
+                                || !self->_m_worker_enabled;
+                            });
+                        if (!self->_m_worker_enabled)
+                            return;
+
+                    } while (false);
+
+                    self->_m_round(worker_id);
+
+                    if (_gc_work_thread_count == ++self->_m_gc_mark_end_count)
+                    {
+                        // All mark thread end, notify..
+                        std::lock_guard g1(self->_m_gc_end_mx);
+                        self->_m_gc_end_cv.notify_all();
+                    }
+
+                } while (true);
+            }
+        public:
+            _gc_mark_thread_groups()
+                : _m_gc_mark_threads(new std::thread[_gc_work_thread_count])
+                , _m_gc_begin_flags(new std::atomic_flag[_gc_work_thread_count])
+            {
+                start();
+            }
+            ~_gc_mark_thread_groups()
+            {
+                stop();
+            }
+            static _gc_mark_thread_groups& instancce()
+            {
+                static _gc_mark_thread_groups g;
+                return g;
+            }
+        public:
+            void stop()
+            {
+#ifdef WO_SINGLE_THREADED
+                _m_worker_enabled = false;
+                return;
+#endif
+                if (_m_worker_enabled)
+                {
+                    std::lock_guard g1(_m_gc_begin_mx);
+                    _m_worker_enabled = false;
+                    _m_gc_begin_cv.notify_all();
+                }
+
+                for (size_t id = 0; id < _gc_work_thread_count; ++id)
+                    _m_gc_mark_threads[id].join();
+            }
+            void start()
+            {
+                if (!_m_worker_enabled)
+                {
+                    _m_worker_enabled = true;
+#ifdef WO_SINGLE_THREADED
+                    return;
+#endif
+                    for (size_t id = 0; id < _gc_work_thread_count; ++id)
+                    {
+                        _m_gc_begin_flags[id].test_and_set(); // make sure gcmarkers donot work at begin.
+                        _m_gc_mark_threads[id] = std::move(std::thread(_gcmarker_thread_work, this, id));
+                    }
+                }
+            }
+
+            void launch_round_of_mark_roots()
+            {
+                _launch_round(_gc_mark_roots_round);
+            }
+
+            void launch_round_of_full_mark()
+            {
+                _gc_idle_marker_count = 0;
+
+                for (size_t id = 0; id < _gc_work_thread_count; ++id)
+                    _gc_gray_unit_deques[id].release_retired_buffers();
+
+                _launch_round(_gc_full_mark_round);
+            }
+
+            void launch_round_of_sweep()
+            {
+                _gc_sweep_chunk_index = 0;
+
+                _launch_round(_gc_sweep_round);
+
+                _gc_sweep_chunks.clear();
+            }
+
+        private:
+            void _launch_round(void (*round)(size_t))
+            {
+#ifdef WO_SINGLE_THREADED
+                // No gc-marker thread in single-threaded build, rounds are done by current thread.
+                round(0);
+                return;
+#endif
+                _m_round = round;
+                _m_gc_mark_end_count = 0;
+
+                do
+                {
+                    std::lock_guard g1(_m_gc_begin_mx);
+                    for (size_t id = 0; id < _gc_work_thread_count; ++id)
+                        _m_gc_begin_flags[id].clear();
+
+                    _m_gc_begin_cv.notify_all();
+                } while (false);
+
+
+                do
+                {
+                    std::unique_lock ug1(_m_gc_end_mx);
+                    _m_gc_end_cv.wait(ug1, [this]() {return _m_gc_mark_end_count == _gc_work_thread_count; });
+                } while (false);
+            }
+        };
+
+        void mark_nogc_child(gcbase* picked_list, size_t worker_id)
+        {
+            while (picked_list)
+            {
+                if (picked_list->gc_type == gcbase::gctype::no_gc
+                    && gcbase::gcmarkcolor::no_mark == picked_list->gc_marked(_gc_round_count))
+                    gc_mark_unit_as_gray(worker_id, picked_list);
+
+                picked_list = picked_list->last;
+            }
+        }
+
+        // Statistics updated out of gc rounds, by finalizer threads & resumed vms.
+        void _gc_fill_live_stats(wo_gc_stats* stats)
+        {
+            stats->finalizer_backlog_count = _gc_finalizer_backlog_count;
+            stats->finalized_count = _gc_finalized_count;
+            stats->prompt_handle_count = gc_handle_base_t::alive_prompt_count;
+
+            const uint64_t resumed_count = vmbase::_vm_resumed_count;
+            stats->max_time_to_resume = (double)vmbase::_vm_max_resume_time / 1e9;
+            stats->avg_time_to_resume = resumed_count == 0
+                ? 0. : (double)vmbase::_vm_total_resume_time / 1e9 / (double)resumed_count;
+        }
+
+        bool _gc_should_full_collect(gcheap* heap)
+        {
+            if (!config::ENABLE_GC_MINOR_COLLECTION || _gc_full_collect_requested)
+                return true;
+
+            // Exceeding memory quota is confirmed by full gc, garbage in old edge should be freed.
+            if (heap->m_quota_checking_count != 0)
+                return true;
+
+            // Old edge grows too much since last full gc.
+            return heap->m_promoted_count_since_full_collect >= std::max(
+                heap->m_old_count_after_full_collect, _gc_min_promoted_count_to_full_collect);
+        }
+
+        void _gc_push_remembered_units_as_gray()
+        {
+            std::vector<gcbase*> remembered_units;
+            do
+            {
+                std::lock_guard g1(_gc_remembered_units_mx);
+                remembered_units.swap(_gc_remembered_units);
+            } while (0);
+
+            std::vector<gcbase*> kept_units, current_remembered_units;
+            for (size_t i = 0; i < remembered_units.size(); ++i)
+            {
+                gcbase* unit = remembered_units[i];
+
+                // Units of other heaps should be kept for their own collection, but units of
+                // default heap might hold young units of collecting isolated heap.
+                const bool is_other_heap_unit = _gc_collecting_heap_id != unit->gc_heap_id;
+                if (is_other_heap_unit)
+                {
+                    kept_units.push_back(unit);
+                    if (_gc_collecting_heap_id != 0 && unit->gc_heap_id != 0)
+                        continue;
+                }
+                else
+                {
+                    unit->gc_remembered = false;
+                    current_remembered_units.push_back(unit);
+                }
+
+                // In full gc, old units will be marked from roots, but units of default heap
+                // might not be reachable from vms of collecting isolated heap.
+                if (_gc_is_minor_collecting || is_other_heap_unit)
+                {
+                    // All markers are sleeping now, gc-thread can push units to their deques.
+                    unit->gc_mark(_gc_round_count, gcbase::gcmarkcolor::self_mark);
+                    _gc_gray_unit_deques[i % _gc_work_thread_count].push(unit);
+                }
+            }
+
+            if (!kept_units.empty())
+            {
+                std::lock_guard g1(_gc_remembered_units_mx);
+                _gc_remembered_units.insert(_gc_remembered_units.end(), kept_units.begin(), kept_units.end());
+            }
+
+            // Units remembered in last round of collecting heap: `a[i] = v` gives out ref of
+            // slot before the pause, and store it after container traced without remembering.
+            std::vector<gcbase*> last_remembered_units;
+            last_remembered_units.swap(_gc_last_remembered_units);
+            for (size_t i = 0; i < last_remembered_units.size(); ++i)
+            {
+                gcbase* unit = last_remembered_units[i];
+                if (_gc_collecting_heap_id != unit->gc_heap_id)
+                    _gc_last_remembered_units.push_back(unit);
+                else if (_gc_is_minor_collecting
+                    && gcbase::gcmarkcolor::no_mark == unit->gc_marked(_gc_round_count))
+                {
+                    unit->gc_mark(_gc_round_count, gcbase::gcmarkcolor::self_mark);
+                    _gc_gray_unit_deques[i % _gc_work_thread_count].push(unit);
+                }
+            }
+            _gc_last_remembered_units.insert(_gc_last_remembered_units.end(),
+                current_remembered_units.begin(), current_remembered_units.end());
+        }
+
+        // Units kept for next round might be freed by this round, must be done before sweeping.
+        void _gc_drop_dead_last_remembered_units()
+        {
+            _gc_last_remembered_units.erase(
+                std::remove_if(_gc_last_remembered_units.begin(), _gc_last_remembered_units.end(),
+                    _gc_is_unit_dead),
+                _gc_last_remembered_units.end());
+        }
+
+        size_t _gc_decide_work_thread_count()
+        {
+            if (config::GC_WORKER_THREAD_COUNT != 0)
+                return config::GC_WORKER_THREAD_COUNT;
+
+            // Use half of hardware threads, leave others for vm.
+            const size_t hardware_thread_count = (size_t)std::thread::hardware_concurrency();
+            return std::clamp(hardware_thread_count / 2, (size_t)1, (size_t)16);
+        }
+
+        void _gc_adjust_edges(gcheap* heap, size_t allocated_bytes, size_t young_count, size_t young_survived_count)
+        {
+            const size_t nursery_size = std::max(config::GC_NURSERY_SIZE, (size_t)1024);
+            const size_t stop_the_world_size = std::max(
+                config::GC_STOP_THE_WORLD_SIZE == 0 ? nursery_size * 5 : config::GC_STOP_THE_WORLD_SIZE,
+                nursery_size);
+
+            auto now = std::chrono::steady_clock::now();
+            const double elapsed_sec = std::max(
+                std::chrono::duration<double>(now - heap->m_last_work_end_time).count(), 0.001);
+            heap->m_last_work_end_time = now;
+
+            const double allocate_rate = (double)allocated_bytes / elapsed_sec;
+            heap->m_last_allocate_rate = allocate_rate;
+
+            if (!config::ENABLE_GC_ADAPTIVE_THRESHOLD)
+            {
+                heap->m_immediately_edge = nursery_size;
+                heap->m_stop_the_world_edge = stop_the_world_size;
+                return;
+            }
+
+            // If allocating quickly, make sure gc will not work too frequently.
+            double edge = std::max((double)nursery_size, allocate_rate * 0.05);
+
+            // If most of units survived, collecting more frequently is useless.
+            if (young_count != 0)
+                edge *= 1.0 + 3.0 * (double)young_survived_count / (double)young_count;
+
+            heap->m_immediately_edge = (size_t)std::min(edge, (double)nursery_size * 32.0);
+            heap->m_stop_the_world_edge = (size_t)((double)heap->m_immediately_edge
+                * (double)stop_the_world_size / (double)nursery_size);
+        }
+
+        // Heap snapshot format, all integers are in native byte order:
+        //  "WOHEAP01"
+        //  'R' u8 root_kind u32 vm_index u64 slot u64 unit_id
+        //  'N' u64 unit_id u8 unit_type u8 gc_type u64 size u32 edge_count u64 unit_id * edge_count
+        //  'E'
+        // Nodes are written one by one while walking gcunit lists, so no extra copy of heap is made.
+        class _gc_heap_snapshot_writer
+        {
+            FILE* m_file;
+            std::vector<uint64_t> m_edges;
+
+            template<typename T>
+            void _write(T data)
+            {
+                fwrite(&data, sizeof(T), 1, m_file);
+            }
+        public:
+            _gc_heap_snapshot_writer(FILE* file)
+                : m_file(file)
+            {
+                fwrite("WOHEAP01", 1, 8, m_file);
+            }
+            void write_root(_gc_root_kind kind, uint32_t vm_index, size_t slot, gcbase* unit)
+            {
+                _write('R');
+                _write((uint8_t)kind);
+                _write(vm_index);
+                _write((uint64_t)slot);
+                _write((uint64_t)(intptr_t)unit);
+            }
+            void write_units(gcbase* picked_list)
+            {
+                for (; picked_list; picked_list = picked_list->last)
+                {
+                    // Unmarked units will be freed in this round, no_gc units are always alive.
+                    if (picked_list->gc_marked(_gc_round_count) == gcbase::gcmarkcolor::no_mark
+                        && picked_list->gc_type != gcbase::gctype::no_gc)
+                        continue;
+
+                    m_edges.clear();
+                    do
+                    {
+                        wo::gcbase::gc_mark_read_guard g1(picked_list);
+                        _gc_for_each_child(picked_list, [this](gcbase* child)
+                            {
+                                m_edges.push_back((uint64_t)(intptr_t)child);
+                            });
+                    } while (0);
+
+                    _write('N');
+                    _write((uint64_t)(intptr_t)picked_list);
+                    _write((uint8_t)picked_list->gc_unit_type);
+                    _write((uint8_t)picked_list->gc_type);
+                    _write((uint64_t)picked_list->gc_size());
+                    _write((uint32_t)m_edges.size());
+                    if (!m_edges.empty())
+                        fwrite(m_edges.data(), sizeof(uint64_t), m_edges.size(), m_file);
+                }
+            }
+            bool finish()
+            {
+                _write('E');
+                return !ferror(m_file);
+            }
+        };
+
+        // World must be stopped & all units are marked.
+        bool _gc_write_heap_snapshot(const std::string& path, const std::vector<gcbase*>& picked_lists)
+        {
+            FILE* file = fopen(path.c_str(), "wb");
+            if (file == nullptr)
+                return false;
+
+            // Write by large buffer, snapshot of huge heap might be GBs.
+            std::vector<char> file_buffer(1 << 20);
+            setvbuf(file, file_buffer.data(), _IOFBF, file_buffer.size());
+
+            _gc_heap_snapshot_writer writer(file);
+            do
+            {
+                std::shared_lock sg1(vmbase::_alive_vm_list_mx);
+
+                uint32_t vm_index = 0;
+                for (auto* vmimpl : vmbase::_alive_vm_list)
+                {
+                    _gc_for_each_root(vmimpl, vmimpl->virtual_machine_type,
+                        [&](_gc_root_kind kind, size_t slot, gcbase* unit)
+                        {
+                            writer.write_root(kind, vm_index, slot, unit);
+                        });
+                    ++vm_index;
+                }
+            } while (0);
+
+            for (auto* picked_list : picked_lists)
+                writer.write_units(picked_list);
+
+            const bool result = writer.finish();
+            return 0 == fclose(file) && result;
+        }
+
+        // Vms of the heap will be paused & scanned, all vms for default heap.
+        bool _gc_is_vm_of_collecting_heap(vmbase* vm)
+        {
+            return _gc_collecting_heap == &gcheap::default_heap || vm->gc_heap == _gc_collecting_heap;
         }
 
-        void _gc_work_list()
+        void _gc_work_list(gcheap* heap)
         {
 #ifdef WO_PLATRORM_OS_WINDOWS
             SetThreadDescription(GetCurrentThread(), L"wo_gc_main");
 #endif
 
+            using clock = std::chrono::steady_clock;
+            auto duration_sec = [](clock::time_point begin, clock::time_point end)
+            {
+                return std::chrono::duration<double>(end - begin).count();
+            };
+
+            clock::time_point stop_world_begin_time, stop_world_end_time, mark_begin_time, mark_end_time;
+            gcbase* eden_list = nullptr;
+            double max_time_to_safepoint = 0., total_time_to_safepoint = 0.;
+            size_t safepoint_vm_count = 0;
+
+            _gc_collecting_heap = heap;
+            _gc_collecting_heap_id = heap->m_id;
+            ++heap->m_started_collect_count;
+
+            // Heap snapshot need full gc & stopping the world, all heaps will be traced in default heap's gc.
+            bool taking_snapshot = false;
+            std::string snapshot_path;
+            do
+            {
+                std::lock_guard g1(_gc_snapshot_mx);
+                if (_gc_snapshot_requested && heap == &gcheap::default_heap)
+                {
+                    _gc_snapshot_requested = false;
+                    taking_snapshot = true;
+                    snapshot_path = _gc_snapshot_path;
+
+                    _gc_stopping_world_gc = true;
+                    _gc_full_collect_requested = true;
+                }
+            } while (0);
+
             // 0. get current vm list, set stop world flag to TRUE:
             do
             {
@@ -426,39 +1730,83 @@ namespace wo
                 _gc_is_marking = true;
 
                 // 1. Interrupt all vm as GC_INTERRUPT, let all vm hang-up
+                stop_world_begin_time = clock::now();
+#ifndef WO_SINGLE_THREADED
                 for (auto* vmimpl : vmbase::_alive_vm_list)
-                    if (vmimpl->virtual_machine_type == vmbase::vm_type::NORMAL)
+                    if (vmimpl->virtual_machine_type == vmbase::vm_type::NORMAL && _gc_is_vm_of_collecting_heap(vmimpl))
                         vmimpl->interrupt(vmbase::GC_INTERRUPT);
 
                 for (auto* vmimpl : vmbase::_alive_vm_list)
-                    if (vmimpl->virtual_machine_type == vmbase::vm_type::NORMAL)
+                    if (vmimpl->virtual_machine_type == vmbase::vm_type::NORMAL && _gc_is_vm_of_collecting_heap(vmimpl))
+                    {
                         vmimpl->wait_interrupt(vmbase::GC_INTERRUPT);
 
+                        // VMs are waited one by one, so it's the time since interrupting.
+                        const double time_to_safepoint = duration_sec(stop_world_begin_time, clock::now());
+                        max_time_to_safepoint = std::max(max_time_to_safepoint, time_to_safepoint);
+                        total_time_to_safepoint += time_to_safepoint;
+                        ++safepoint_vm_count;
+                    }
+#endif
+                mark_begin_time = clock::now();
+
+                // 1.1 Decide to do minor gc or full gc, remembered units should be taken when
+                //     world stopped, units remembered after this will be handled in next round.
+                _gc_is_minor_collecting = !_gc_should_full_collect(heap);
+                _gc_full_collect_requested = false;
+                _gc_push_remembered_units_as_gray();
+
+                // 1.2 Eden units are picked while world stopped, units allocated before this are
+                //     all traced by this round, so the round confirming quota can free them.
+                _gc_is_confirming_quota = heap->m_quota_checking_count != 0
+                    && heap->m_started_collect_count >= heap->m_quota_checking_count;
+                eden_list = heap == &gcheap::default_heap
+                    ? gcbase::pick_all_eden_gcunits()
+                    : heap->m_eden_gcunit_list.pick_all();
+
                 // 2. Mark all unit in vm's stack, register, global(only once)
-                _gc_scan_vm_count = vmbase::_alive_vm_list.size();
+                std::vector<vmbase*> vmlist;
+                vmlist.reserve(vmbase::_alive_vm_list.size());
 
-                std::vector<vmbase*> vmlist(_gc_scan_vm_count);
+                for (auto* vmimpl : vmbase::_alive_vm_list)
+                    if (_gc_is_vm_of_collecting_heap(vmimpl))
+                        vmlist.push_back(vmimpl);
 
-                auto vm_index = vmbase::_alive_vm_list.begin();
-                for (size_t i = 0; i < _gc_scan_vm_count; ++i)
-                    vmlist[i] = *(vm_index++);
+                _gc_scan_vm_count = vmlist.size();
                 _gc_vm_list = vmlist.data();
                 _gc_scan_vm_index = 0;
 
                 // 3. Start GC Worker for first marking        
-                _gc_mark_thread_groups::instancce().launch_round_of_mark();
+                _gc_root_scan_deadline = mark_begin_time
+                    + std::chrono::microseconds(config::GC_ROOT_SCAN_PAUSE_BUDGET);
+                _gc_mark_thread_groups::instancce().launch_round_of_mark_roots();
 
+                stop_world_end_time = clock::now();
+#ifndef WO_SINGLE_THREADED
                 if (!_gc_stopping_world_gc)
+                {
                     for (auto* vmimpl : vmbase::_alive_vm_list)
-                        if (vmimpl->virtual_machine_type == vmbase::vm_type::NORMAL)
+                        if (vmimpl->virtual_machine_type == vmbase::vm_type::NORMAL && _gc_is_vm_of_collecting_heap(vmimpl))
                             if (!vmimpl->clear_interrupt(vmbase::GC_INTERRUPT))
                                 vmimpl->wakeup();
-
+                    vmbase::resume_hanged_vms();
+                }
+#endif
             } while (0);
+
+            // 3.1 Holding units of gchandles are marked as roots, dead gchandles are not reachable
+            //     by vms, so it can be done after world resumed.
+            _gc_scan_holding_handles();
+
+            // 3.2 Scan remaining stack slots of vms, vms returning to them will scan them by
+            //     themselves, see vmbase::gc_return_barrier.
+            _gc_scan_pending_stacks();
+
             // just full gc:
-            auto* eden_list = gcbase::eden_age_gcunit_list.pick_all();
-            auto* young_list = gcbase::young_age_gcunit_list.pick_all();
-            auto* old_list = gcbase::old_age_gcunit_list.pick_all();
+            auto* young_list = heap->m_young_gcunit_list.pick_all();
+            // Old edge will not be collected in minor gc.
+            auto* old_list = _gc_is_minor_collecting ? nullptr : heap->m_old_gcunit_list.pick_all();
+            auto* large_list = _gc_is_minor_collecting ? nullptr : heap->m_large_gcunit_list.pick_all();
 
             // Mark all no_gc_object
             // mark_nogc_child(eden_list, 0 % _gc_work_thread_count);
@@ -466,17 +1814,104 @@ namespace wo
             // mark_nogc_child(old_list, 2 % _gc_work_thread_count);
 
             // 4. OK, Continue mark gray to black
-            _gc_mark_thread_groups::instancce().launch_round_of_mark();
+            _gc_mark_thread_groups::instancce().launch_round_of_full_mark();
 
-            // Marking finished.
+            // Marking finished, weak slots cannot be read until they are cleared.
+            _gc_weak_slots_mx.lock();
             _gc_is_marking = false;
 
-            // 5. OK, All unit has been marked. reduce gcunits
-            check_and_move_edge_to_edge(old_list, &gcbase::old_age_gcunit_list, nullptr, gcbase::gctype::old, UINT16_MAX);
-            check_and_move_edge_to_edge(young_list, &gcbase::young_age_gcunit_list, &gcbase::old_age_gcunit_list, gcbase::gctype::old, _gc_max_count_to_move_young_to_old);
+            // 4.1 Flush all satb buffers & mark remained units, all markers are sleeping now,
+            //     so gc-thread can use deque of marker 0.
+            if (gc_flush_all_satb_buffers() != 0 || _gc_satb_flushed_unit_count != 0)
+            {
+                gc_drain_satb_units(0);
+                while (gcbase* markingunit = _gc_gray_unit_deques[0].pop())
+                    gc_mark_unit_as_black(0, markingunit);
+            }
+            mark_end_time = clock::now();
+
+            // 4.2 Clear weak slots holding unmarked units.
+            _gc_clear_weak_slots();
+            _gc_weak_slots_mx.unlock();
+            _gc_drop_dead_last_remembered_units();
+
+            // 4.3 Write heap snapshot before unmarked units freed.
+            if (taking_snapshot)
+            {
+                // Units of isolated heaps are not picked, but they are traced & cannot be freed now.
+                std::vector<gcbase*> snapshot_lists = { eden_list, young_list, old_list, large_list };
+                do
+                {
+                    std::lock_guard g1(_gc_isolated_heaps_mx);
+                    for (auto* isolated_heap : _gc_isolated_heaps)
+                    {
+                        snapshot_lists.push_back(isolated_heap->m_eden_gcunit_list.last_node.load());
+                        snapshot_lists.push_back(isolated_heap->m_young_gcunit_list.last_node.load());
+                        snapshot_lists.push_back(isolated_heap->m_old_gcunit_list.last_node.load());
+                        snapshot_lists.push_back(isolated_heap->m_large_gcunit_list.last_node.load());
+                    }
+                } while (0);
+
+                const bool snapshot_result = _gc_write_heap_snapshot(snapshot_path, snapshot_lists);
+
+                std::lock_guard g1(_gc_snapshot_mx);
+                _gc_snapshot_result = snapshot_result;
+                _gc_snapshot_finished = true;
+                _gc_snapshot_cv.notify_all();
+            }
 
+            // 5. OK, All unit has been marked. reduce gcunits by gc-markers.
+            _gc_sweep_result old_result, large_result, young_result, eden_result;
+            if (!_gc_is_minor_collecting)
+            {
+                _gc_add_sweep_chunks(old_list, &heap->m_old_gcunit_list, nullptr, gcbase::gctype::old, UINT16_MAX,
+                    nullptr, &old_result);
+                _gc_add_sweep_chunks(large_list, &heap->m_large_gcunit_list, nullptr, gcbase::gctype::old, UINT16_MAX,
+                    nullptr, &large_result);
+            }
+            // Large units in young & eden will be moved to large-object space directly.
+            _gc_add_sweep_chunks(young_list, &heap->m_young_gcunit_list, &heap->m_old_gcunit_list, gcbase::gctype::old, _gc_max_count_to_move_young_to_old,
+                &heap->m_large_gcunit_list, &young_result);
             // Move all eden to young
-            check_and_move_edge_to_edge(eden_list, nullptr, &gcbase::young_age_gcunit_list, gcbase::gctype::young, 0);
+            _gc_add_sweep_chunks(eden_list, nullptr, &heap->m_young_gcunit_list, gcbase::gctype::young, 0,
+                &heap->m_large_gcunit_list, &eden_result);
+
+            _gc_mark_thread_groups::instancce().launch_round_of_sweep();
+
+            const auto sweep_end_time = clock::now();
+
+#ifndef WO_SINGLE_THREADED
+            if (_gc_finalizer_backlog_count != 0)
+            {
+                std::lock_guard g1(_gc_finalizer_mx);
+                _gc_finalizer_cv.notify_all();
+            }
+#endif
+
+            if (!_gc_is_minor_collecting)
+            {
+                heap->m_old_count_after_full_collect = old_result.m_survived_count + large_result.m_survived_count;
+                heap->m_old_bytes = old_result.m_survived_bytes + large_result.m_survived_bytes;
+                heap->m_large_count_after_full_collect = large_result.m_survived_count;
+                heap->m_promoted_count_since_full_collect = 0;
+                heap->m_large_count_since_full_collect = 0;
+            }
+            const size_t large_moved_count = young_result.m_large_moved_count + eden_result.m_large_moved_count;
+            heap->m_large_count_since_full_collect += large_moved_count;
+            heap->m_promoted_count_since_full_collect += young_result.m_moved_count + large_moved_count;
+            heap->m_old_bytes += young_result.m_moved_bytes
+                + young_result.m_large_moved_bytes + eden_result.m_large_moved_bytes;
+
+            _gc_adjust_edges(heap, heap->m_allocated_bytes_before_work, young_result.m_total_count, young_result.m_survived_count);
+
+            do
+            {
+                std::lock_guard g1(_gc_quota_mx);
+                ++heap->m_finished_collect_count;
+                if (heap->m_live_bytes <= (int64_t)heap->m_memory_quota.load())
+                    heap->m_quota_checking_count = 0;
+                _gc_quota_cv.notify_all();
+            } while (0);
 
             // 6. Remove orpho vm
             std::list<vmbase*> need_destruct_gc_destructor_list;
@@ -499,13 +1934,67 @@ namespace wo
                 }
 
                 if (_gc_stopping_world_gc)
+                {
+                    stop_world_end_time = clock::now();
+#ifndef WO_SINGLE_THREADED
                     for (auto* vmimpl : vmbase::_alive_vm_list)
-                        if (vmimpl->virtual_machine_type == vmbase::vm_type::NORMAL)
+                        if (vmimpl->virtual_machine_type == vmbase::vm_type::NORMAL && _gc_is_vm_of_collecting_heap(vmimpl))
                             if (!vmimpl->clear_interrupt(vmbase::GC_INTERRUPT))
                                 vmimpl->wakeup();
+                    vmbase::resume_hanged_vms();
+#endif
+                }
+
+            } while (0);
 
+            // 7. Update statistics
+            wo_gc_stats_callback stats_callback = _gc_stats_callback;
+            wo_gc_stats stats;
+            do
+            {
+                std::lock_guard g1(_gc_stats_mx);
+
+                const double pause_time = duration_sec(stop_world_begin_time, stop_world_end_time);
+
+                _gc_stats.cycle_count++;
+                _gc_stats.is_minor_collect = _gc_is_minor_collecting;
+                _gc_stats.pause_time = pause_time;
+                _gc_stats.max_pause_time = std::max(_gc_stats.max_pause_time, pause_time);
+                _gc_stats.total_pause_time += pause_time;
+                _gc_stats.max_time_to_safepoint = max_time_to_safepoint;
+                _gc_stats.avg_time_to_safepoint = safepoint_vm_count == 0
+                    ? 0. : total_time_to_safepoint / (double)safepoint_vm_count;
+                _gc_stats.mark_time = duration_sec(mark_begin_time, mark_end_time);
+                _gc_stats.sweep_time = duration_sec(mark_end_time, sweep_end_time);
+
+                _gc_stats.eden_count = eden_result.m_total_count;
+                _gc_stats.eden_bytes = eden_result.m_survived_bytes;
+                _gc_stats.young_live_count = young_result.m_survived_count
+                    - young_result.m_moved_count - young_result.m_large_moved_count;
+                _gc_stats.young_live_bytes = young_result.m_survived_bytes
+                    - young_result.m_moved_bytes - young_result.m_large_moved_bytes;
+                _gc_stats.young_freed_count = young_result.m_total_count - young_result.m_survived_count;
+                _gc_stats.young_freed_bytes = young_result.m_freed_bytes;
+                _gc_stats.promoted_count = young_result.m_moved_count;
+                _gc_stats.promoted_bytes = young_result.m_moved_bytes;
+                _gc_stats.old_live_count = heap->m_old_count_after_full_collect + heap->m_promoted_count_since_full_collect;
+                _gc_stats.old_live_bytes = heap->m_old_bytes;
+                _gc_stats.old_freed_count = old_result.m_total_count - old_result.m_survived_count
+                    + large_result.m_total_count - large_result.m_survived_count;
+                _gc_stats.old_freed_bytes = old_result.m_freed_bytes + large_result.m_freed_bytes;
+                _gc_stats.large_object_count = heap->m_large_count_after_full_collect + heap->m_large_count_since_full_collect;
+                _gc_stats.large_object_bytes = los::allocated_bytes();
+                _gc_fill_live_stats(&_gc_stats);
+
+                _gc_stats.memo_record_count = _gc_satb_recorded_count.exchange(0);
+                _gc_stats.allocate_rate = heap->m_last_allocate_rate;
+
+                stats = _gc_stats;
             } while (0);
 
+            if (stats_callback != nullptr)
+                stats_callback(&stats);
+
 
             for (auto* destruct_vm : need_destruct_gc_destructor_list)
                 delete destruct_vm;
@@ -514,41 +2003,252 @@ namespace wo
             _gc_stopping_world_gc = false;
         }
 
+        // Heap exceeded memory quota should be collected before vm fail, see _gc_check_memory_quota.
+        bool _gc_is_quota_checking_pending(gcheap* heap)
+        {
+            return heap->m_quota_checking_count > heap->m_started_collect_count;
+        }
+
+        // Called by vm's thread when live bytes of heap exceed the quota, units might be garbage,
+        // so vm will wait for next full gc of the heap at safepoint, see gc_confirm_memory_quota.
+        void _gc_check_memory_quota(gcheap* heap)
+        {
+            vmbase* vm = vmbase::_this_thread_vm;
+            if (vm == nullptr || vm->virtual_machine_type != vmbase::vm_type::NORMAL)
+                return;
+
+            size_t checking_count = heap->m_quota_checking_count;
+            if (checking_count == 0
+                && heap->m_quota_checking_count.compare_exchange_strong(
+                    checking_count, heap->m_started_collect_count + 1))
+            {
+#ifndef WO_SINGLE_THREADED
+                if (!_gc_budget_exhausted_notified.exchange(true))
+                {
+                    std::lock_guard g1(_gc_work_mx);
+                    _gc_work_cv.notify_one();
+                }
+#endif
+            }
+            // Allocating cannot be interrupted, vm will wait at next safepoint.
+            vm->interrupt(vmbase::MEMORY_QUOTA_INTERRUPT);
+        }
+
+        bool gc_confirm_memory_quota(gcheap* heap)
+        {
+            // Bytes counted by current thread should be seen by gc-thread.
+            if (gcbase::thread_allocated_bytes != 0 || gcbase::thread_freed_bytes != 0)
+                gcbase::flush_thread_allocated_bytes();
+
+            size_t checking_count = heap->m_quota_checking_count;
+#ifdef WO_SINGLE_THREADED
+            while (checking_count != 0 && heap->m_finished_collect_count < checking_count)
+            {
+                gc_work_at_safepoint();
+                checking_count = heap->m_quota_checking_count;
+            }
+#else
+            // Gc is not started, live bytes cannot be reduced.
+            if (_gc_work_thread_count != 0)
+            {
+                std::unique_lock ug1(_gc_quota_mx);
+                _gc_quota_cv.wait(ug1, [&]() {
+                    checking_count = heap->m_quota_checking_count;
+                    return checking_count == 0
+                        || heap->m_finished_collect_count >= checking_count
+                        || _gc_stop_flag;
+                    });
+            }
+#endif
+            if (checking_count != 0 && heap->m_live_bytes > (int64_t)heap->m_memory_quota.load())
+            {
+                // Exceeding confirmed, next exceeding will be checked again.
+                heap->m_quota_checking_count.compare_exchange_strong(checking_count, 0);
+                return true;
+            }
+            return false;
+        }
+
+        // Take budget of the heap if exhausted, return true if the heap should be collected.
+        bool _gc_take_heap_budget(gcheap* heap, bool force, bool* out_stopping_world)
+        {
+            heap->m_allocated_bytes_before_work = heap->m_new_bytes;
+            *out_stopping_world = false;
+
+            if (heap->m_allocated_bytes_before_work > heap->m_stop_the_world_edge)
+            {
+                *out_stopping_world = true;
+                heap->m_new_bytes -= heap->m_stop_the_world_edge;
+                return true;
+            }
+            else if (heap->m_allocated_bytes_before_work > heap->m_immediately_edge)
+            {
+                heap->m_new_bytes -= heap->m_immediately_edge;
+                return true;
+            }
+            return force || _gc_is_quota_checking_pending(heap);
+        }
+
+        std::vector<gcheap*> _gc_get_all_heaps()
+        {
+            std::lock_guard g1(_gc_isolated_heaps_mx);
+
+            std::vector<gcheap*> heaps = { &gcheap::default_heap };
+            heaps.insert(heaps.end(), _gc_isolated_heaps.begin(), _gc_isolated_heaps.end());
+            return heaps;
+        }
+
+        // Units of isolated heap which have no vm will be collected in default heap.
+        void _gc_merge_unused_heaps()
+        {
+            std::vector<gcheap*> unused_heaps;
+            do
+            {
+                std::lock_guard g1(_gc_isolated_heaps_mx);
+                for (auto* heap : _gc_isolated_heaps)
+                    if (heap->m_alive_vm_count == 0)
+                        unused_heaps.push_back(heap);
+
+                for (auto* heap : unused_heaps)
+                    _gc_isolated_heaps.erase(
+                        std::find(_gc_isolated_heaps.begin(), _gc_isolated_heaps.end(), heap));
+            } while (0);
+
+            auto merge_list = [](atomic_list<gcbase>& from, atomic_list<gcbase>& to)
+            {
+                if (gcbase* head = from.pick_all())
+                {
+                    gcbase* tail = head;
+                    for (;;)
+                    {
+                        tail->gc_heap_id = 0;
+                        if (tail->last == nullptr)
+                            break;
+                        tail = tail->last;
+                    }
+                    to.add_list(head, tail);
+                }
+            };
+
+            gcheap& default_heap = gcheap::default_heap;
+            for (auto* heap : unused_heaps)
+            {
+                merge_list(heap->m_eden_gcunit_list, default_heap.m_eden_gcunit_list);
+                merge_list(heap->m_young_gcunit_list, default_heap.m_young_gcunit_list);
+                merge_list(heap->m_old_gcunit_list, default_heap.m_old_gcunit_list);
+                merge_list(heap->m_large_gcunit_list, default_heap.m_large_gcunit_list);
+
+                default_heap.m_new_bytes += heap->m_new_bytes;
+                default_heap.m_live_bytes += heap->m_live_bytes;
+                default_heap.m_promoted_count_since_full_collect +=
+                    heap->m_old_count_after_full_collect + heap->m_promoted_count_since_full_collect;
+                default_heap.m_old_bytes += heap->m_old_bytes;
+                default_heap.m_large_count_since_full_collect +=
+                    heap->m_large_count_after_full_collect + heap->m_large_count_since_full_collect;
+
+                do
+                {
+                    // Id can be reused after all units' gc_heap_id reset.
+                    std::lock_guard g1(_gc_isolated_heaps_mx);
+                    _gc_free_heap_ids.push_back(heap->m_id);
+                } while (0);
+
+                delete heap;
+            }
+        }
+
+        // Prompt gchandles survived in full gc cannot be collected by next gc, make sure gc will
+        // not be requested too frequently.
+        void _gc_adjust_prompt_handle_edge(size_t surviving_count)
+        {
+            _gc_prompt_handle_edge = std::max(config::GC_PROMPT_HANDLE_LIMIT, surviving_count * 2);
+            _gc_prompt_collect_requested = false;
+        }
+
+        void _gc_collect_heaps(const std::vector<std::pair<gcheap*, bool>>& collecting_heaps, bool full_collect_requested)
+        {
+            if (full_collect_requested)
+                _gc_prompt_handle_marked_count = 0;
+
+            for (auto& [heap, stopping_world] : collecting_heaps)
+            {
+                _gc_full_collect_requested = full_collect_requested;
+                _gc_stopping_world_gc = stopping_world;
+                _gc_work_list(heap);
+            }
+
+            if (full_collect_requested)
+                _gc_adjust_prompt_handle_edge(_gc_prompt_handle_marked_count);
+
+            _gc_merge_unused_heaps();
+        }
+
+        std::vector<std::pair<gcheap*, bool>> _gc_take_budgets(bool full_collect_requested)
+        {
+            std::vector<std::pair<gcheap*, bool>> collecting_heaps;
+            for (auto* heap : _gc_get_all_heaps())
+            {
+                bool stopping_world;
+                if (_gc_take_heap_budget(heap, full_collect_requested, &stopping_world))
+                    collecting_heaps.push_back({ heap, stopping_world });
+            }
+            return collecting_heaps;
+        }
+
+#ifdef WO_SINGLE_THREADED
+        // Collecting is not reentrant, finalizers might allocate & run vm.
+        bool _gc_collecting_at_safepoint = false;
+
+        void _gc_collect_now(bool full_collect_requested)
+        {
+            if (_gc_collecting_at_safepoint)
+                return;
+
+            _gc_collecting_at_safepoint = true;
+            _gc_collect_heaps(_gc_take_budgets(full_collect_requested), full_collect_requested);
+            _gc_finalize_queued_handles();
+            _gc_collecting_at_safepoint = false;
+        }
+
+        void gc_work_at_safepoint()
+        {
+            // Collecting required by wo_gc_immediately, do full gc for all heaps.
+            _gc_collect_now(!_gc_immediately.test_and_set());
+        }
+#endif
+
         void _gc_main_thread()
         {
+            // Default heap will be collected at first.
+            std::vector<std::pair<gcheap*, bool>> collecting_heaps = { {&gcheap::default_heap, false} };
+            bool full_collect_requested = false;
+
             do
             {
-                _gc_work_list();
+                _gc_collect_heaps(collecting_heaps, full_collect_requested);
+                full_collect_requested = false;
 
                 do
                 {
                     std::unique_lock ug1(_gc_work_mx);
-                    for (size_t i = 0; i < 100; ++i)
-                    {
-                        using namespace std;
-                        bool breakout = false;
 
-                        if (gcbase::gc_new_count > _gc_immediately_edge)
+                    // GC-thread will be waked up only when allocating budget exhausted or
+                    // collecting is required, idle process will never wake it up.
+                    _gc_budget_exhausted_notified = false;
+                    _gc_work_cv.wait(ug1, [&]() {
+                        if (_gc_stop_flag || !_gc_immediately.test_and_set())
                         {
-                            if (gcbase::gc_new_count > _gc_stop_the_world_edge)
-                            {
-                                _gc_stopping_world_gc = true;
-                                gcbase::gc_new_count -= _gc_stop_the_world_edge;
-                            }
-                            else
-                                gcbase::gc_new_count -= _gc_immediately_edge;
-                            break;
+                            // Collecting required by wo_gc_immediately, do full gc for all heaps.
+                            full_collect_requested = true;
+                            return true;
                         }
+                        for (auto* heap : _gc_get_all_heaps())
+                            if (heap->m_new_bytes > heap->m_immediately_edge || _gc_is_quota_checking_pending(heap))
+                                return true;
+                        return false;
+                        });
 
-                        _gc_work_cv.wait_for(ug1, 0.1s, [&]() {
-                            if (_gc_stop_flag || !_gc_immediately.test_and_set())
-                                breakout = true;
-                            return breakout;
-                            });
-
-                        if (breakout)
-                            break;
-                    }
+                    collecting_heaps = _gc_take_budgets(full_collect_requested);
                 } while (false);
 
             } while (!_gc_stop_flag);
@@ -556,17 +2256,261 @@ namespace wo
 
         void gc_start()
         {
+            if (_gc_work_thread_count == 0)
+            {
+                // Marker count cannot be changed after gc-markers started.
+#ifdef WO_SINGLE_THREADED
+                _gc_work_thread_count = 1;
+#else
+                _gc_work_thread_count = _gc_decide_work_thread_count();
+#endif
+                _gc_gray_unit_deques.reset(new _gc_mark_deque[_gc_work_thread_count]);
+            }
+            gcheap::default_heap.m_last_work_end_time = std::chrono::steady_clock::now();
+            _gc_adjust_edges(&gcheap::default_heap, 0, 0, 0);
+            _gc_adjust_prompt_handle_edge(0);
+
             _gc_stop_flag = false;
             _gc_immediately.test_and_set();
+            _gc_start_finalizers();
+#ifndef WO_SINGLE_THREADED
             _gc_scheduler_thread = std::move(std::thread(_gc_main_thread));
+#endif
         }
 
     } // END NAME SPACE gc
 
+    void vmbase::gc_return_barrier(value* returning_callstack)
+    {
+        wo_assert(returning_callstack->type == value::valuetype::barriercallstack);
+
+        returning_callstack->type = value::valuetype::callstack;
+        gc_frame_barrier(stack_mem_begin - returning_callstack->bp);
+    }
+
+    void vmbase::gc_frame_barrier(value* frame_bp)
+    {
+        std::lock_guard g1(gc_stack_scan_mx);
+
+        value* scanned_end = gc_stack_watermark;
+        if (scanned_end == nullptr)
+            // All slots have been scanned by gc-thread.
+            return;
+
+        value* const stack_end = stack_mem_begin + 1;
+        value* const bound = gc::_gc_frame_scan_bound(this, frame_bp);
+        if (bound > scanned_end)
+        {
+            gc::_gc_scan_slots(this, scanned_end, bound, bound, gc::gc_record_satb_unit);
+            scanned_end = bound;
+        }
+
+        if (scanned_end == stack_end)
+            gc_stack_watermark = nullptr;
+        else
+        {
+            // Guard the frame, caller of it might not be scanned.
+            (frame_bp + 1)->type = value::valuetype::barriercallstack;
+            gc_stack_watermark = scanned_end;
+        }
+    }
+
+    void gcbase::flush_thread_allocated_bytes()
+    {
+        gcheap* heap = gcheap::thread_heap == nullptr ? &gcheap::default_heap : gcheap::thread_heap;
+
+        const size_t new_bytes = heap->m_new_bytes += thread_allocated_bytes;
+        const int64_t live_bytes = heap->m_live_bytes +=
+            (int64_t)thread_allocated_bytes - (int64_t)thread_freed_bytes;
+        thread_allocated_bytes = 0;
+        thread_freed_bytes = 0;
+
+        const size_t memory_quota = heap->m_memory_quota.load(std::memory_order_relaxed);
+        if (memory_quota != 0 && live_bytes > (int64_t)memory_quota)
+            gc::_gc_check_memory_quota(heap);
+
+#ifdef WO_SINGLE_THREADED
+        // Collect when current vm reached safepoint, vm cannot be scanned while allocating.
+        vmbase* vm = vmbase::_this_thread_vm;
+        if (new_bytes > heap->m_immediately_edge
+            && vm != nullptr
+            && vm->virtual_machine_type == vmbase::vm_type::NORMAL)
+        {
+            vm->interrupt(vmbase::GC_INTERRUPT);
+        }
+#else
+        if (new_bytes > heap->m_immediately_edge && !gc::_gc_budget_exhausted_notified.exchange(true))
+        {
+            std::lock_guard g1(gc::_gc_work_mx);
+            gc::_gc_work_cv.notify_one();
+        }
+#endif
+    }
+
+    gcheap* gcheap::switch_thread_heap(gcheap* heap)
+    {
+        // Allocated bytes should be counted into the heap which allocated them.
+        if (gcbase::thread_allocated_bytes != 0 || gcbase::thread_freed_bytes != 0)
+            gcbase::flush_thread_allocated_bytes();
+
+        gcheap* last_heap = thread_heap;
+        thread_heap = heap;
+        return last_heap;
+    }
+
+    gcheap* gcheap::create()
+    {
+        uint16_t id;
+        do
+        {
+            std::lock_guard g1(gc::_gc_isolated_heaps_mx);
+            if (!gc::_gc_free_heap_ids.empty())
+            {
+                id = gc::_gc_free_heap_ids.back();
+                gc::_gc_free_heap_ids.pop_back();
+            }
+            else if (gc::_gc_next_heap_id != UINT16_MAX)
+                id = gc::_gc_next_heap_id++;
+            else
+                return nullptr;
+        } while (0);
+
+        gcheap* heap = new gcheap(id);
+        gc::_gc_adjust_edges(heap, 0, 0, 0);
+
+        // Created heap is used by the vm which create it.
+        heap->m_alive_vm_count = 1;
+
+        std::lock_guard g1(gc::_gc_isolated_heaps_mx);
+        gc::_gc_isolated_heaps.push_back(heap);
+        return heap;
+    }
+
+    void gcheap::add_vm(gcheap* heap)
+    {
+        ++heap->m_alive_vm_count;
+    }
+
+    void gcheap::remove_vm(gcheap* heap)
+    {
+        wo_assert(heap->m_alive_vm_count != 0);
+        --heap->m_alive_vm_count;
+    }
+
+    void gc_handle_base_t::set_holding_value(value* val)
+    {
+        holding_value.set_val(val);
+        if (holding_value.is_gcunit())
+        {
+            // DONOT let holding unit be freed before gchandle closed.
+            holding_value.gcunit->gc_type = gcbase::gctype::no_gc;
+
+            is_registered = true;
+            gc::_gc_holding_handles.add_one(this);
+        }
+    }
+
+    void gc_handle_base_t::set_prompt()
+    {
+        wo_assert(!is_prompt && !has_been_closed);
+
+        is_prompt = true;
+
+        // Jit code copies values without counting.
+        if (!config::ENABLE_JUST_IN_TIME)
+        {
+            is_counted = true;
+            ref_count = 1;
+            counted_handle_created = true;
+        }
+
+        if (++alive_prompt_count > gc::_gc_prompt_handle_edge
+            && !gc::_gc_prompt_collect_requested.exchange(true))
+            wo_gc_immediately();
+    }
+
+    void gc_handle_base_t::release_reference()
+    {
+        if (--ref_count == 0)
+        {
+            vmbase* vm = vmbase::_this_thread_vm;
+            if (vm != nullptr && !(vm->vm_interrupt & vmbase::vm_interrupt_type::LEAVE_INTERRUPT))
+            {
+                // Destructor might wait for gc (such as closing vm), close it when the running
+                // vm leaves, it keeps pinned until closed, see vmbase::close_released_handles.
+                vm->m_released_handles.push_back(this);
+                vm->interrupt(vmbase::vm_interrupt_type::RELEASED_HANDLE_INTERRUPT);
+                return;
+            }
+            close();
+        }
+        --releasing_count;
+    }
+
+    void gc_handle_base_t::set_weak(weak_type type)
+    {
+        wo_assert(weak == weak_type::not_weak && !is_registered);
+
+        weak = type;
+        is_registered = true;
+        gc::_gc_holding_handles.add_one(this);
+    }
+
+    bool gc_handle_base_t::get_weak_value(value* out_val)
+    {
+        wo_assert(weak == weak_type::weak_value);
+
+        // Wait for gc-thread if it is clearing weak slots.
+        std::shared_lock sg1(gc::_gc_weak_slots_mx);
+        gcbase::gc_mark_read_guard g1(static_cast<gchandle_t*>(this));
+
+        if (has_been_closed || holding_value.is_nil())
+            return false;
+
+        out_val->set_val(&holding_value);
+
+        // Weakly held unit is not marked, record it if marking, out_val might have been scanned.
+        if (gc::gc_is_marking())
+            if (gcbase* unit = out_val->get_gcunit_with_barrier())
+                gc::gc_record_satb_unit(unit);
+
+        return true;
+    }
+
+    void gcbase::add_remembered_gcunit(gcbase* unit)
+    {
+        std::lock_guard g1(gc::_gc_remembered_units_mx);
+        gc::_gc_remembered_units.push_back(unit);
+    }
+
+    void gcbase::add_memo(const value* val)
+    {
+        // Container has been full-marked, values in it have been marked.
+        if (gc_mark_version == gc::_gc_round_count && gc_mark_color == gcmarkcolor::full_mark)
+            return;
+
+        if (auto* mem = val->get_gcunit_with_barrier())
+        {
+            // Marked unit needn't be recorded again.
+            if (mem->gc_mark_version == gc::_gc_round_count && mem->gc_mark_color != gcmarkcolor::no_mark)
+                return;
+
+            gc::gc_record_satb_unit(mem);
+        }
+    }
 }
 
 void wo_gc_immediately()
 {
+#ifdef WO_SINGLE_THREADED
+    wo::gc::_gc_immediately.clear();
+    if (wo::vmbase* vm = wo::vmbase::_this_thread_vm)
+        // Collect at next safepoint of current vm.
+        vm->interrupt(wo::vmbase::GC_INTERRUPT);
+    else
+        wo::gc::gc_work_at_safepoint();
+    return;
+#endif
     std::lock_guard g1(wo::gc::_gc_work_mx);
     wo::gc::_gc_immediately.clear();
     wo::gc::_gc_work_cv.notify_one();
@@ -581,5 +2525,79 @@ void wo_gc_stop()
         wo::gc::_gc_work_cv.notify_one();
     } while (false);
 
-    wo::gc::_gc_scheduler_thread.join();
-}
\ No newline at end of file
+    do
+    {
+        // Vms waiting for confirming memory quota should not wait any more.
+        std::lock_guard g1(wo::gc::_gc_quota_mx);
+        wo::gc::_gc_quota_cv.notify_all();
+    } while (false);
+
+    if (wo::gc::_gc_scheduler_thread.joinable())
+        wo::gc::_gc_scheduler_thread.join();
+
+    // Close all dead gchandles found in last round.
+    wo::gc::_gc_stop_finalizers();
+}
+wo_bool_t wo_gc_dump_heap_snapshot(wo_string_t path)
+{
+    // Only one snapshot can be requested at same time.
+    std::lock_guard g0(wo::gc::_gc_snapshot_request_mx);
+
+    do
+    {
+        std::lock_guard g1(wo::gc::_gc_snapshot_mx);
+        wo::gc::_gc_snapshot_path = path;
+        wo::gc::_gc_snapshot_requested = true;
+        wo::gc::_gc_snapshot_finished = false;
+    } while (false);
+
+#ifdef WO_SINGLE_THREADED
+    // Vms are not running now, the world can be traced here.
+    wo::gc::_gc_immediately.clear();
+    wo::gc::gc_work_at_safepoint();
+#else
+    wo_gc_immediately();
+#endif
+
+    std::unique_lock ug1(wo::gc::_gc_snapshot_mx);
+    wo::gc::_gc_snapshot_cv.wait(ug1, []() {
+        return wo::gc::_gc_snapshot_finished || wo::gc::_gc_stop_flag; });
+
+    wo::gc::_gc_snapshot_requested = false;
+    return wo::gc::_gc_snapshot_finished && wo::gc::_gc_snapshot_result;
+}
+
+void wo_gc_get_stats(wo_gc_stats* out_stats)
+{
+    std::lock_guard g1(wo::gc::_gc_stats_mx);
+    *out_stats = wo::gc::_gc_stats;
+    wo::gc::_gc_fill_live_stats(out_stats);
+}
+
+wo_gc_stats_callback wo_gc_regist_stats_callback(wo_gc_stats_callback callback)
+{
+    return wo::gc::_gc_stats_callback.exchange(callback);
+}
+
+void wo_gc_set_memory_quota(wo_vm vm, size_t max_bytes)
+{
+    wo::gcheap* heap = reinterpret_cast<wo::vmbase*>(vm)->gc_heap;
+    if (heap == nullptr)
+        heap = &wo::gcheap::default_heap;
+
+    heap->m_memory_quota = max_bytes;
+    heap->m_quota_checking_count = 0;
+}
+
+size_t wo_gc_get_memory_used(wo_vm vm)
+{
+    wo::gcheap* heap = reinterpret_cast<wo::vmbase*>(vm)->gc_heap;
+    if (heap == nullptr)
+        heap = &wo::gcheap::default_heap;
+
+    // Bytes counted by current thread might be of the heap.
+    if (wo::gcbase::thread_allocated_bytes != 0 || wo::gcbase::thread_freed_bytes != 0)
+        wo::gcbase::flush_thread_allocated_bytes();
+
+    return (size_t)std::max(heap->m_live_bytes.load(), (int64_t)0);
+}
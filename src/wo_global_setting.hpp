@@ -109,5 +109,143 @@ namespace wo
         * --------------------------------------------------------------------
         */
         inline bool ENABLE_JUST_IN_TIME = false;
+
+        /*
+        * ENABLE_OUTPUT_ELIMINATED_FUNCTION_INFO = false
+        * --------------------------------------------------------------------
+        *   Named functions which are not referenced by reachable code will
+        * not be generated into runtime code.
+        * --------------------------------------------------------------------
+        *   if ENABLE_OUTPUT_ELIMINATED_FUNCTION_INFO is true, compiler will
+        * print the eliminated functions and the bytes saved.
+        * --------------------------------------------------------------------
+        */
+        inline bool ENABLE_OUTPUT_ELIMINATED_FUNCTION_INFO = false;
+
+        /*
+        * GC_WORKER_THREAD_COUNT = 0
+        * --------------------------------------------------------------------
+        *   Count of gc marking threads, it will be read when gc start.
+        * --------------------------------------------------------------------
+        *   if GC_WORKER_THREAD_COUNT is 0, half of hardware threads will be
+        * used (at least 1, at most 16).
+        *   Can be set by '--gc-worker-count' or env WOOLANG_GC_WORKER_COUNT.
+        * --------------------------------------------------------------------
+        */
+        inline size_t GC_WORKER_THREAD_COUNT = 0;
+
+        /*
+        * GC_FINALIZER_THREAD_COUNT = 2
+        * --------------------------------------------------------------------
+        *   Count of threads closing dead gchandles, it will be read when gc
+        * start.
+        * --------------------------------------------------------------------
+        *   if GC_FINALIZER_THREAD_COUNT is 0, dead gchandles will be closed
+        * by gc-markers while sweeping.
+        *   Can be set by '--gc-finalizer-count' or env
+        * WOOLANG_GC_FINALIZER_COUNT.
+        * --------------------------------------------------------------------
+        */
+        inline size_t GC_FINALIZER_THREAD_COUNT = 2;
+
+        /*
+        * GC_NURSERY_SIZE = 4MB
+        * --------------------------------------------------------------------
+        *   When bytes of gcunits allocated after last gc is more than this
+        * size, gc will work immediately.
+        *   Can be set by '--gc-nursery-size' or env WOOLANG_GC_NURSERY_SIZE.
+        * --------------------------------------------------------------------
+        */
+        inline size_t GC_NURSERY_SIZE = 4 * 1024 * 1024;
+
+        /*
+        * GC_STOP_THE_WORLD_SIZE = 0
+        * --------------------------------------------------------------------
+        *   When bytes of gcunits allocated after last gc is more than this
+        * size, gc will stop all vm until marking end.
+        * --------------------------------------------------------------------
+        *   if GC_STOP_THE_WORLD_SIZE is 0, GC_NURSERY_SIZE * 5 will be used.
+        *   Can be set by '--gc-stop-the-world-size' or env
+        * WOOLANG_GC_STOP_THE_WORLD_SIZE.
+        * --------------------------------------------------------------------
+        */
+        inline size_t GC_STOP_THE_WORLD_SIZE = 0;
+
+        /*
+        * GC_LARGE_OBJECT_SIZE = 128KB
+        * --------------------------------------------------------------------
+        *   Buffers of arrays & structs which are larger than this size will
+        * be mapped from os directly, units holding them will be moved to
+        * large-object space when survived from eden, and only be collected
+        * in full gc. 0 means disable large-object space.
+        *   Can be set by '--gc-large-object-size' or env
+        * WOOLANG_GC_LARGE_OBJECT_SIZE, cannot be changed after wo_init.
+        * --------------------------------------------------------------------
+        */
+        inline size_t GC_LARGE_OBJECT_SIZE = 128 * 1024;
+
+        /*
+        * ENABLE_GC_ADAPTIVE_THRESHOLD = true
+        * --------------------------------------------------------------------
+        *   if ENABLE_GC_ADAPTIVE_THRESHOLD is true, the sizes above will be
+        * used as the lower bound, gc will enlarge them by the allocating rate
+        * and the ratio of survived young units.
+        *   Can be set by '--enable-gc-adaptive' or env WOOLANG_GC_ADAPTIVE.
+        * --------------------------------------------------------------------
+        */
+        inline bool ENABLE_GC_ADAPTIVE_THRESHOLD = true;
+
+        /*
+        * ENABLE_GC_MINOR_COLLECTION = true
+        * --------------------------------------------------------------------
+        *   if ENABLE_GC_MINOR_COLLECTION is true, gc will only mark & collect
+        * eden/young units in most rounds, old units will be collected when
+        * old edge grows too much or wo_gc_immediately is called.
+        *   Can be set by '--enable-gc-minor' or env WOOLANG_GC_MINOR.
+        * --------------------------------------------------------------------
+        */
+        inline bool ENABLE_GC_MINOR_COLLECTION = true;
+
+        /*
+        * ENABLE_GC_ISOLATED_HEAP = false
+        * --------------------------------------------------------------------
+        *   if ENABLE_GC_ISOLATED_HEAP is true, each vm created by host will
+        * have it's own heap, vms created from it share the heap. A heap is
+        * collected with only it's vms paused.
+        *   Values MUST NOT be passed between vms of different heaps by host.
+        *   Can be set by '--enable-gc-isolated-heap' or env
+        * WOOLANG_GC_ISOLATED_HEAP.
+        * --------------------------------------------------------------------
+        */
+        inline bool ENABLE_GC_ISOLATED_HEAP = false;
+
+        /*
+        * GC_ROOT_SCAN_PAUSE_BUDGET = 1000
+        * --------------------------------------------------------------------
+        *   Microseconds gc-markers can spend on scanning vms' stacks while
+        * the world is stopped. Only top frames of vms are scanned in pause
+        * when time out, remaining frames will be scanned after vms resumed,
+        * vm returning to them will scan them by itself.
+        * --------------------------------------------------------------------
+        *   if GC_ROOT_SCAN_PAUSE_BUDGET is 0, whole stacks will be scanned in
+        * pause.
+        *   Can be set by '--gc-root-scan-budget' or env
+        * WOOLANG_GC_ROOT_SCAN_BUDGET.
+        * --------------------------------------------------------------------
+        */
+        inline size_t GC_ROOT_SCAN_PAUSE_BUDGET = 1000;
+
+        /*
+        * GC_PROMPT_HANDLE_LIMIT = 64
+        * --------------------------------------------------------------------
+        *   Full gc will be requested when count of alive prompt gchandles
+        * exceeds the limit (or twice of survived ones in last full gc), then
+        * dead prompt gchandles which are not released by reference counting
+        * will be closed by finalizers, see function wo_gchandle_set_prompt.
+        *   Can be set by '--gc-prompt-handle-limit' or env
+        * WOOLANG_GC_PROMPT_HANDLE_LIMIT.
+        * --------------------------------------------------------------------
+        */
+        inline size_t GC_PROMPT_HANDLE_LIMIT = 64;
     }
 }
\ No newline at end of file
@@ -134,7 +134,13 @@ namespace wo
                                         //  10 begin ? DIFF(4BYTE):ROLLBACK ? 0BYTE : DIFF(4BYTE)
                                         //  01 thorw
                                         //  00 clean
-            mkunion = 8 WO_OPCODE_SPACE   // mkunion(dr_0) REGID(1BYTE)/DIFF(4BYTE) id(2BYTE)
+            mkunion = 8 WO_OPCODE_SPACE,  // mkunion(dr_0) REGID(1BYTE)/DIFF(4BYTE) id(2BYTE)
+            idarr = 9 WO_OPCODE_SPACE,    // ext(00) idarr(dr) REGID(1BYTE)/DIFF(4BYTE) REGID/DIFF
+                                          //  index array by integer, no type dispatch.
+            nextarr = 10 WO_OPCODE_SPACE, // ext(00) nextarr(dr) REGID(1BYTE)/DIFF(4BYTE) REGID/DIFF
+                                          //  ++index, cr = index < size, ths = ref of array[index]
+            jmptab = 11 WO_OPCODE_SPACE,  // ext(00) jmptab(dr_0) COUNT(2BYTE) PLACE(4BYTE) * COUNT
+                                          //  jmp to PLACE[cr], if cr out of range, skip the table.
 
         };
         enum extern_opcode_page_1 : uint8_t
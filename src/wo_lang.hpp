@@ -3,6 +3,7 @@
 #include "wo_basic_type.hpp"
 #include "wo_lang_ast_builder.hpp"
 #include "wo_compiler_ir.hpp"
+#include "wo_stdlib.hpp"
 
 #include <unordered_map>
 #include <unordered_set>
@@ -30,6 +31,9 @@ namespace wo
         bool is_constexpr = false;
         ast::identifier_decl decl = ast::identifier_decl::IMMUTABLE;
         bool is_captured_variable = false;
+        bool is_used_as_value = false;
+        // Variables which refer a local closure as value, see get_direct_called_closure.
+        std::vector<ast::ast_value_variable*> value_referenced_variables;
 
         union
         {
@@ -682,6 +686,168 @@ namespace wo
             else
                 lang_anylizer->lang_error(0x0000, pattern, WO_ERR_UNEXPECT_PATTERN_MODE);
         }
+        // If the immutable variable is a closure which only be called directly (or passed to
+        // specialized higher-order functions) in the same function and all captured variables
+        // are immutable, the closure can be called without making it, just push captured
+        // variables and call the function.
+        static ast::ast_value_function_define* get_direct_called_closure(lang_symbol* symbol)
+        {
+            using namespace ast;
+
+            if (symbol == nullptr
+                || symbol->type != lang_symbol::symbol_type::variable
+                || symbol->decl != identifier_decl::IMMUTABLE
+                || symbol->is_used_as_value
+                || symbol->static_symbol
+                || symbol->is_captured_variable
+                || symbol->is_constexpr
+                || symbol->is_template_symbol
+                || !symbol->define_in_function)
+                return nullptr;
+
+            for (auto* referenced_variable : symbol->value_referenced_variables)
+            {
+                if (!referenced_variable->is_specialized_functor)
+                    return nullptr;
+            }
+
+            auto* closure = dynamic_cast<ast_value_function_define*>(symbol->variable_value);
+            if (closure == nullptr
+                || !closure->is_closure_function()
+                || closure->externed_func_info
+                || closure->is_template_define)
+                return nullptr;
+
+            if (!symbol->value_referenced_variables.empty()
+                && closure->value_type->is_variadic_function_type)
+                return nullptr;
+
+            for (auto* captured_symbol : closure->capture_variables)
+            {
+                if (captured_symbol->decl != identifier_decl::IMMUTABLE)
+                    return nullptr;
+            }
+            return closure;
+        }
+
+        enum class higher_order_function
+        {
+            NONE,
+            TRANS,
+            FORALL,
+            COLLECT,
+        };
+
+        // std::array::trans/forall/collect will be expanded at the place they are called, so the
+        // functor can be called directly, see analyze_specialized_higher_order_funccall.
+        static higher_order_function get_specialized_higher_order_function(ast::ast_value_funccall* funccall)
+        {
+            using namespace ast;
+
+            auto* fdef = dynamic_cast<ast_value_function_define*>(funccall->called_func);
+            if (fdef == nullptr
+                || fdef->externed_func_info
+                || !fdef->is_template_reification
+                || funccall->is_mark_as_using_ref
+                || fdef->source_file != wo_stdlib_src_path
+                || fdef->get_namespace_chain() != "array")
+                return higher_order_function::NONE;
+
+            size_t argument_count = 0;
+            for (auto* arg = funccall->arguments->children; arg; arg = arg->sibling)
+            {
+                auto* arg_val = dynamic_cast<ast_value*>(arg);
+                if (arg_val == nullptr
+                    || arg_val->is_mark_as_using_ref
+                    || dynamic_cast<ast_fakevalue_unpacked_args*>(arg_val))
+                    return higher_order_function::NONE;
+                ++argument_count;
+            }
+            if (argument_count != 2)
+                return higher_order_function::NONE;
+
+            if (fdef->function_name == L"trans")
+                return higher_order_function::TRANS;
+            if (fdef->function_name == L"forall")
+                return higher_order_function::FORALL;
+            if (fdef->function_name == L"collect")
+                return higher_order_function::COLLECT;
+            return higher_order_function::NONE;
+        }
+
+        // Get the function define of functor if it can be called directly in specialized
+        // higher-order function.
+        static ast::ast_value_function_define* get_specialized_functor(ast::ast_value* functor)
+        {
+            using namespace ast;
+
+            auto* fdef = dynamic_cast<ast_value_function_define*>(functor);
+            if (auto* a_value_variable = dynamic_cast<ast_value_variable*>(functor))
+                fdef = a_value_variable->is_specialized_functor
+                ? get_direct_called_closure(a_value_variable->symbol)
+                : nullptr;
+
+            if (fdef == nullptr
+                || fdef->externed_func_info
+                || fdef->is_template_define
+                || fdef->value_type->is_variadic_function_type)
+                return nullptr;
+            return fdef;
+        }
+
+        // Flags for ir_compiler::mark_last_call_as_pure, 0 if the called function is not an
+        // extern function declared as 'pure'.
+        static uint8_t get_pure_call_flags(ast::ast_value_funccall* funccall)
+        {
+            using namespace ast;
+
+            auto* fdef = dynamic_cast<ast_value_function_define*>(funccall->called_func);
+            if (auto* a_value_variable = dynamic_cast<ast_value_variable*>(funccall->called_func);
+                a_value_variable
+                && a_value_variable->symbol
+                && a_value_variable->symbol->type == lang_symbol::symbol_type::function
+                && a_value_variable->symbol->function_overload_sets.size() == 1)
+                fdef = a_value_variable->symbol->function_overload_sets.front();
+
+            if (fdef == nullptr
+                || fdef->externed_func_info == nullptr
+                || !fdef->externed_func_info->is_pure
+                || funccall->is_mark_as_using_ref)
+                return 0;
+
+            uint8_t flags = ir_compiler::PURE_CALL | ir_compiler::PURE_CALL_IMMUTABLE_ARGS;
+            for (auto* arg = funccall->arguments->children; arg; arg = arg->sibling)
+            {
+                auto* arg_val = dynamic_cast<ast_value*>(arg);
+                if (arg_val == nullptr
+                    || arg_val->is_mark_as_using_ref
+                    || dynamic_cast<ast_fakevalue_unpacked_args*>(arg_val))
+                    return 0;
+
+                if (!arg_val->is_constant)
+                {
+                    auto* a_value_variable = dynamic_cast<ast_value_variable*>(arg_val);
+                    if (a_value_variable == nullptr
+                        || a_value_variable->symbol == nullptr
+                        || a_value_variable->symbol->type != lang_symbol::symbol_type::variable
+                        || a_value_variable->symbol->decl != identifier_decl::IMMUTABLE)
+                        flags &= ~ir_compiler::PURE_CALL_IMMUTABLE_ARGS;
+                }
+
+                // Values of these types cannot be changed, others (like array) might be
+                // changed after the function called.
+                auto* arg_type = arg_val->value_type;
+                if (!arg_type->is_integer()
+                    && !arg_type->is_real()
+                    && !arg_type->is_handle()
+                    && !arg_type->is_bool()
+                    && !arg_type->is_string()
+                    && !arg_type->is_nil())
+                    flags |= ir_compiler::PURE_CALL_READ_REFERRED;
+            }
+            return flags;
+        }
+
         void analyze_pattern_in_finalize(ast::ast_pattern_base* pattern, ast::ast_value* initval, ir_compiler* compiler)
         {
             using namespace ast;
@@ -731,7 +897,12 @@ namespace wo
                                 compiler->jf(tag(init_static_flag_check_tag));
                                 compiler->set(static_inited_flag, imm(1));
                             }
-                            if (ast_value_takeplace* valtkpls = dynamic_cast<ast_value_takeplace*>(initval);
+                            if (get_direct_called_closure(a_pattern_identifier->symbol))
+                            {
+                                // Closure is only used for calling directly, no need to make it.
+                                wo_assert(!a_pattern_identifier->symbol->static_symbol);
+                            }
+                            else if (ast_value_takeplace* valtkpls = dynamic_cast<ast_value_takeplace*>(initval);
                                 !valtkpls || valtkpls->used_reg)
                             {
                                 if (is_need_dup_when_mov(initval))
@@ -2693,6 +2864,13 @@ namespace wo
 
                             if (failed_to_call_cur_func)
                                 a_value_funccall->value_type->set_type_with_name(L"pending");
+                            else if (get_specialized_higher_order_function(a_value_funccall) != higher_order_function::NONE)
+                            {
+                                // Closure passed here will not escape, mark it.
+                                if (auto* functor_variable = dynamic_cast<ast_value_variable*>(
+                                    a_value_funccall->arguments->children->sibling))
+                                    functor_variable->is_specialized_functor = true;
+                            }
                         }
                         else if (ast_value_unary* a_value_unary = dynamic_cast<ast_value_unary*>(ast_node))
                         {
@@ -3987,6 +4165,7 @@ namespace wo
         }
 
         std::vector<ast::ast_value_function_define* > in_used_functions;
+        std::vector<ast::ast_value_function_define* > maybe_unused_functions;
 
         opnum::opnumbase& get_new_global_variable()
         {
@@ -4095,6 +4274,121 @@ namespace wo
             }
         };
 
+        // Expand std::array::trans/forall/collect here, functor will be called directly without
+        // making closure, elements are added by native std::array::add.
+        opnum::opnumbase& analyze_specialized_higher_order_funccall(
+            ast::ast_value_funccall* a_value_funccall,
+            higher_order_function function,
+            ast::ast_value_function_define* functor_define,
+            ir_compiler* compiler)
+        {
+            using namespace ast;
+            using namespace opnum;
+
+            auto* array_value = dynamic_cast<ast_value*>(a_value_funccall->arguments->children);
+            wo_assert(array_value);
+
+            auto array_add_func = rslib_extern_symbols::get_global_symbol("rslib_std_array_add");
+            wo_assert(array_add_func);
+
+            if (functor_define->ir_func_has_been_generated == false)
+            {
+                in_used_functions.push_back(functor_define);
+                functor_define->ir_func_has_been_generated = true;
+            }
+
+            const bool need_store_tc =
+                now_function_in_final_anylize && now_function_in_final_anylize->value_type->is_variadic_function_type;
+            if (need_store_tc)
+                compiler->psh(reg(reg::tc));
+
+            auto& array_opnum = analyze_value(array_value, compiler);
+            auto& iter = get_useable_register_for_pure_value();
+            compiler->set(iter, complete_using_register(array_opnum));
+
+            auto& result = get_useable_register_for_pure_value();
+            compiler->mkarr(result, imm(0));
+
+            auto& iter_index = get_useable_register_for_pure_value();
+            compiler->set(iter_index, imm(-1));
+
+            auto loop_begin_tag = "hof_begin_" + compiler->get_unique_tag_based_command_ip();
+            auto loop_end_tag = "hof_end_" + compiler->get_unique_tag_based_command_ip();
+
+            compiler->tag(loop_begin_tag);
+            compiler->ext_nextarr(iter, iter_index);
+            compiler->jf(tag(loop_end_tag));
+
+            // Element will be used after calling functor in forall, store it.
+            opnumbase* element = &WO_NEW_OPNUM(reg(reg::ths));
+            if (function == higher_order_function::FORALL)
+            {
+                element = &get_useable_register_for_pure_value();
+                compiler->set(*element, reg(reg::ths));
+            }
+
+            compiler->psh(*element);
+            for (auto idx = functor_define->capture_variables.rbegin();
+                idx != functor_define->capture_variables.rend();
+                ++idx)
+                compiler->psh(complete_using_register(get_opnum_by_symbol(functor_define, *idx, compiler)));
+            compiler->call(opnum::tagimm_rsfunc(functor_define->get_ir_func_signature_tag()));
+            compiler->pop(1);
+
+            switch (function)
+            {
+            case higher_order_function::TRANS:
+                compiler->psh(reg(reg::cr));
+                compiler->psh(result);
+                compiler->call(reinterpret_cast<void*>(array_add_func));
+                compiler->pop(2);
+                compiler->jmp(tag(loop_begin_tag));
+                break;
+            case higher_order_function::FORALL:
+                compiler->jf(tag(loop_begin_tag));
+                compiler->psh(*element);
+                compiler->psh(result);
+                compiler->call(reinterpret_cast<void*>(array_add_func));
+                compiler->pop(2);
+                compiler->jmp(tag(loop_begin_tag));
+                complete_using_register(*element);
+                break;
+            case higher_order_function::COLLECT:
+            {
+                auto& inserting_iter = get_useable_register_for_pure_value();
+                compiler->set(inserting_iter, reg(reg::cr));
+                auto& inserting_iter_index = get_useable_register_for_pure_value();
+                compiler->set(inserting_iter_index, imm(-1));
+
+                auto inserting_begin_tag = "hof_inserting_" + compiler->get_unique_tag_based_command_ip();
+                compiler->tag(inserting_begin_tag);
+                compiler->ext_nextarr(inserting_iter, inserting_iter_index);
+                compiler->jf(tag(loop_begin_tag));
+                compiler->psh(reg(reg::ths));
+                compiler->psh(result);
+                compiler->call(reinterpret_cast<void*>(array_add_func));
+                compiler->pop(2);
+                compiler->jmp(tag(inserting_begin_tag));
+
+                complete_using_register(inserting_iter);
+                complete_using_register(inserting_iter_index);
+                break;
+            }
+            default:
+                wo_error("Unknown higher-order function.");
+                break;
+            }
+            compiler->tag(loop_end_tag);
+
+            complete_using_register(iter);
+            complete_using_register(iter_index);
+
+            if (need_store_tc)
+                compiler->pop(reg(reg::tc));
+
+            return result;
+        }
+
         opnum::opnumbase& analyze_value(ast::ast_value* value, ir_compiler* compiler, bool get_pure_value = false, bool need_symbol = true, bool force_value = false)
         {
             if (need_symbol)
@@ -4604,6 +4898,15 @@ namespace wo
             }
             else if (auto* a_value_funccall = dynamic_cast<ast_value_funccall*>(value))
             {
+                if (auto specialized_function = get_specialized_higher_order_function(a_value_funccall);
+                    specialized_function != higher_order_function::NONE)
+                {
+                    auto* functor = dynamic_cast<ast_value*>(a_value_funccall->arguments->children->sibling);
+                    if (auto* functor_define = get_specialized_functor(functor))
+                        return analyze_specialized_higher_order_funccall(
+                            a_value_funccall, specialized_function, functor_define, compiler);
+                }
+
                 if (now_function_in_final_anylize && now_function_in_final_anylize->value_type->is_variadic_function_type)
                     compiler->psh(reg(reg::tc));
 
@@ -4649,7 +4952,26 @@ namespace wo
                     arg = arg->sibling;
                 }
 
-                auto* called_func_aim = &analyze_value(a_value_funccall->called_func, compiler);
+                ast_value_function_define* direct_called_closure = nullptr;
+                if (auto* a_called_variable = dynamic_cast<ast_value_variable*>(a_value_funccall->called_func))
+                    direct_called_closure = get_direct_called_closure(a_called_variable->symbol);
+                else if (auto* a_called_closure = dynamic_cast<ast_value_function_define*>(a_value_funccall->called_func);
+                    a_called_closure && a_called_closure->is_closure_function() && !a_called_closure->externed_func_info)
+                    // Closure will be invoked immediately.
+                    direct_called_closure = a_called_closure;
+
+                opnumbase* called_func_aim = nullptr;
+                if (direct_called_closure)
+                {
+                    if (direct_called_closure->ir_func_has_been_generated == false)
+                    {
+                        in_used_functions.push_back(direct_called_closure);
+                        direct_called_closure->ir_func_has_been_generated = true;
+                    }
+                    called_func_aim = &WO_NEW_OPNUM(opnum::tagimm_rsfunc(direct_called_closure->get_ir_func_signature_tag()));
+                }
+                else
+                    called_func_aim = &analyze_value(a_value_funccall->called_func, compiler);
 
                 ast_value_function_define* fdef = dynamic_cast<ast_value_function_define*>(a_value_funccall->called_func);
                 bool need_using_tc = !dynamic_cast<opnum::immbase*>(called_func_aim)
@@ -4706,6 +5028,15 @@ namespace wo
                 }
 
 
+                if (direct_called_closure)
+                {
+                    // Push captured variables as the closure do.
+                    for (auto idx = direct_called_closure->capture_variables.rbegin();
+                        idx != direct_called_closure->capture_variables.rend();
+                        ++idx)
+                        compiler->psh(complete_using_register(get_opnum_by_symbol(direct_called_closure, *idx, compiler)));
+                }
+
                 if (is_cr_reg(*called_func_aim))
                 {
                     auto& callaimreg = get_useable_register_for_pure_value();
@@ -4726,6 +5057,15 @@ namespace wo
 
                 compiler->call(complete_using_register(*called_func_aim));
 
+                if (!direct_called_closure
+                    && !full_unpack_arguments
+                    && extern_unpack_arg_count == 0
+                    && dynamic_cast<opnum::immbase*>(called_func_aim))
+                {
+                    if (auto pure_call_flags = get_pure_call_flags(a_value_funccall))
+                        compiler->mark_last_call_as_pure(pure_call_flags);
+                }
+
                 last_value_stored_to_cr_flag.write_to_cr();
 
                 opnum::opnumbase* result_storage_place = nullptr;
@@ -5071,7 +5411,10 @@ namespace wo
 
                     last_value_stored_to_cr_flag.write_to_cr();
 
-                    compiler->idx(beoped_left_opnum, op_right_opnum);
+                    if (a_value_index->from->value_type->is_array() && a_value_index->index->value_type->is_integer())
+                        compiler->ext_idarr(beoped_left_opnum, op_right_opnum);
+                    else
+                        compiler->idx(beoped_left_opnum, op_right_opnum);
 
                     complete_using_register(beoped_left_opnum);
                     complete_using_register(op_right_opnum);
@@ -5509,6 +5852,17 @@ namespace wo
                 loop_stack_for_break_and_continue.pop_back();
             }
 
+            else if (auto* a_value_function_define = dynamic_cast<ast_value_function_define*>(ast_node);
+                a_value_function_define
+                && a_value_function_define->function_name != L""
+                && nullptr == a_value_function_define->externed_func_info
+                && !a_value_function_define->is_template_define
+                && !a_value_function_define->is_closure_function()
+                && !a_value_function_define->declear_attribute->is_extern_attr())
+            {
+                // Named function define, it will be generated only when it is referenced.
+                maybe_unused_functions.push_back(a_value_function_define);
+            }
             else if (auto* a_value = dynamic_cast<ast_value*>(ast_node))
             {
                 auto_analyze_value(a_value, compiler);
@@ -5556,7 +5910,35 @@ namespace wo
             }
             else if (ast_foreach* a_foreach = dynamic_cast<ast_foreach*>(ast_node))
             {
-                real_analyze_finalize(a_foreach->used_iter_define, compiler);
+                // If iter is std::array::iter, iterate the array directly by index instead of
+                // creating a gchandle iterator and invoking extern 'next' in every loop.
+                wo_assert(a_foreach->used_iter_define->var_refs.size() == 2);
+
+                auto* iter_pattern = dynamic_cast<ast_pattern_identifier*>(a_foreach->used_iter_define->var_refs[0].pattern);
+                auto* iter_index_pattern = dynamic_cast<ast_pattern_identifier*>(a_foreach->used_iter_define->var_refs[1].pattern);
+                auto* iter_getting_funccall = dynamic_cast<ast_value_funccall*>(a_foreach->used_iter_define->var_refs[0].init_val);
+                wo_assert(iter_pattern && iter_index_pattern && iter_getting_funccall);
+
+                auto* iter_getting_fdef = dynamic_cast<ast_value_function_define*>(iter_getting_funccall->called_func);
+                const bool iterate_array_directly =
+                    iter_getting_fdef
+                    && iter_getting_fdef->externed_func_info
+                    && iter_getting_fdef->externed_func_info->load_from_lib == L""
+                    && iter_getting_fdef->externed_func_info->symbol_name == L"rslib_std_array_iter"
+                    && iter_getting_funccall->directed_value_from
+                    && iter_getting_funccall->directed_value_from->value_type->is_array()
+                    && a_foreach->used_vawo_defines->var_refs.size() <= 2;
+
+                if (iterate_array_directly)
+                {
+                    auto& iter_opnum = get_opnum_by_symbol(iter_pattern, iter_pattern->symbol, compiler);
+                    auto& iter_index_opnum = get_opnum_by_symbol(iter_index_pattern, iter_index_pattern->symbol, compiler);
+
+                    compiler->mov(iter_opnum, complete_using_register(analyze_value(iter_getting_funccall->directed_value_from, compiler)));
+                    compiler->mov(iter_index_opnum, imm(-1));
+                }
+                else
+                    real_analyze_finalize(a_foreach->used_iter_define, compiler);
                 // real_analyze_finalize(a_foreach->used_vawo_defines, compiler);
 
                 auto foreach_begin_tag = "foreach_begin_" + compiler->get_unique_tag_based_command_ip();
@@ -5590,8 +5972,26 @@ namespace wo
                 }
 
                 compiler->tag(foreach_begin_tag);
-                mov_value_to_cr(auto_analyze_value(a_foreach->iter_next_judge_expr, compiler), compiler);
-                compiler->jf(tag(foreach_end_tag));
+                if (iterate_array_directly)
+                {
+                    auto& iter_opnum = get_opnum_by_symbol(iter_pattern, iter_pattern->symbol, compiler);
+                    auto& iter_index_opnum = get_opnum_by_symbol(iter_index_pattern, iter_index_pattern->symbol, compiler);
+
+                    compiler->ext_nextarr(iter_opnum, iter_index_opnum);
+                    compiler->jf(tag(foreach_end_tag));
+
+                    // Same as array::iterator::next(iter, ref out_key, ref out_val)
+                    const size_t pattern_count = a_foreach->foreach_patterns_vars_in_pass2.size();
+                    if (pattern_count == 2)
+                        compiler->mov(*a_foreach->foreach_patterns_vars_in_pass2[0]->used_reg, iter_index_opnum);
+                    if (pattern_count >= 1)
+                        compiler->mov(*a_foreach->foreach_patterns_vars_in_pass2[pattern_count - 1]->used_reg, reg(reg::ths));
+                }
+                else
+                {
+                    mov_value_to_cr(auto_analyze_value(a_foreach->iter_next_judge_expr, compiler), compiler);
+                    compiler->jf(tag(foreach_end_tag));
+                }
 
                 // 2. Apply pattern here!
                 pattern_val_takeplace_id = 0;
@@ -5698,6 +6098,54 @@ namespace wo
                 // 1. Get id in cr.
                 compiler->idstruct(reg(reg::cr), reg(reg::ths), 0);
 
+                // 2. If there are enough cases, dispatch them by jump table instead of comparing id one by one.
+                const size_t MATCH_JUMP_TABLE_MIN_CASE_COUNT = 4;
+
+                std::vector<ast_match_union_case*> union_cases;
+                uint16_t max_union_case_id = 0;
+                bool can_use_jump_table = true;
+                for (auto* cases = a_match->cases->children; cases; cases = cases->sibling)
+                {
+                    auto* a_match_union_case = dynamic_cast<ast_match_union_case*>(cases);
+                    auto* a_pattern_union_value = a_match_union_case
+                        ? dynamic_cast<ast_pattern_union_value*>(a_match_union_case->union_pattern)
+                        : nullptr;
+
+                    if (!a_pattern_union_value || a_match->match_value->value_type->is_pending())
+                    {
+                        can_use_jump_table = false;
+                        break;
+                    }
+
+                    auto fnd = a_match->match_value->value_type->struct_member_index.find(a_pattern_union_value->union_expr->var_name);
+                    if (fnd == a_match->match_value->value_type->struct_member_index.end())
+                    {
+                        can_use_jump_table = false;
+                        break;
+                    }
+
+                    union_cases.push_back(a_match_union_case);
+                    max_union_case_id = std::max(max_union_case_id, fnd->second.offset);
+                }
+
+                if (can_use_jump_table && union_cases.size() >= MATCH_JUMP_TABLE_MIN_CASE_COUNT)
+                {
+                    // Cases not given will jump to match end, same as comparing one by one.
+                    std::vector<std::string> case_tags((size_t)max_union_case_id + 1, a_match->match_end_tag_in_final_pass);
+                    for (auto* a_match_union_case : union_cases)
+                    {
+                        auto& case_tag = case_tags[a_match->match_value->value_type->struct_member_index.at(
+                            dynamic_cast<ast_pattern_union_value*>(a_match_union_case->union_pattern)->union_expr->var_name).offset];
+
+                        // If same case given more than once, first one will be matched.
+                        if (case_tag == a_match->match_end_tag_in_final_pass)
+                            case_tag = a_match_union_case->case_begin_tag_in_final_pass =
+                            compiler->get_unique_tag_based_command_ip() + "case_begin";
+                    }
+                    compiler->ext_jmptab(opnum::tag_table(case_tags));
+                    compiler->jmp(tag(a_match->match_end_tag_in_final_pass));
+                }
+
                 real_analyze_finalize(a_match->cases, compiler);
 
                 compiler->tag(a_match->match_end_tag_in_final_pass);
@@ -5719,10 +6167,12 @@ namespace wo
                     auto fnd = a_match_union_case->in_match->match_value->value_type->struct_member_index.find(case_item->var_name);
                     if (fnd == a_match_union_case->in_match->match_value->value_type->struct_member_index.end())
                         lang_anylizer->lang_error(0x0000, a_match_union_case, WO_ERR_UNKNOWN_CASE_TYPE);
-                    else
+                    else if (a_match_union_case->case_begin_tag_in_final_pass.empty())
                     {
                         compiler->jnequb(imm((wo_integer_t)fnd->second.offset), tag(current_case_end));
                     }
+                    else
+                        compiler->tag(a_match_union_case->case_begin_tag_in_final_pass);
 
                     if (a_pattern_union_value->pattern_arg_in_union_may_nil)
                     {
@@ -5782,116 +6232,155 @@ namespace wo
             size_t public_block_begin = compiler->get_now_ip();
             auto res_ip = compiler->reserved_stackvalue();                      // reserved..
             real_analyze_finalize(ast_node, compiler);
+            compiler->optimize_pure_values(public_block_begin);
             auto used_tmp_regs = compiler->update_all_temp_regist_to_stack(public_block_begin);
             compiler->reserved_stackvalue(res_ip, used_tmp_regs); // set reserved size
 
             compiler->jmp(opnum::tag("__rsir_rtcode_seg_function_define_end"));
-            while (!in_used_functions.empty())
+            auto generate_in_used_functions = [this](ir_compiler* compiler)
             {
-                auto tmp_build_func_list = in_used_functions;
-                in_used_functions.clear();
-                for (auto* funcdef : tmp_build_func_list)
+                while (!in_used_functions.empty())
                 {
-                    // If current is template, the node will not be compile, just skip it.
-                    if (funcdef->is_template_define)
-                        continue;
-
-                    size_t funcbegin_ip = compiler->get_now_ip();
-                    now_function_in_final_anylize = funcdef;
-
-                    compiler->tag(funcdef->get_ir_func_signature_tag());
-                    if (funcdef->declear_attribute->is_extern_attr())
+                    auto tmp_build_func_list = in_used_functions;
+                    in_used_functions.clear();
+                    for (auto* funcdef : tmp_build_func_list)
                     {
-                        // this function is externed, put it into extern-table and update the value in ir-compiler
-                        auto&& spacename = funcdef->get_namespace_chain();
+                        // If current is template, the node will not be compile, just skip it.
+                        if (funcdef->is_template_define)
+                            continue;
 
-                        auto&& fname = (spacename.empty() ? "" : spacename + "::") + wstr_to_str(funcdef->function_name);
-                        if (compiler->pdb_info->extern_function_map.find(fname)
-                            != compiler->pdb_info->extern_function_map.end())
-                        {
-                            this->lang_anylizer->lang_error(0x0000, funcdef,
-                                WO_ERR_CANNOT_EXPORT_SAME_NAME_FUNCTION,
-                                str_to_wstr(fname).c_str());
-                        }
-                        else
-                            compiler->pdb_info->extern_function_map[fname] = compiler->get_now_ip();
+                        size_t funcbegin_ip = compiler->get_now_ip();
+                        now_function_in_final_anylize = funcdef;
 
-                    }
+                        compiler->tag(funcdef->get_ir_func_signature_tag());
+                        if (funcdef->declear_attribute->is_extern_attr())
+                        {
+                            // this function is externed, put it into extern-table and update the value in ir-compiler
+                            auto&& spacename = funcdef->get_namespace_chain();
 
-                    compiler->pdb_info->generate_func_begin(funcdef, compiler);
+                            auto&& fname = (spacename.empty() ? "" : spacename + "::") + wstr_to_str(funcdef->function_name);
+                            if (compiler->pdb_info->extern_function_map.find(fname)
+                                != compiler->pdb_info->extern_function_map.end())
+                            {
+                                this->lang_anylizer->lang_error(0x0000, funcdef,
+                                    WO_ERR_CANNOT_EXPORT_SAME_NAME_FUNCTION,
+                                    str_to_wstr(fname).c_str());
+                            }
+                            else
+                                compiler->pdb_info->extern_function_map[fname] = compiler->get_now_ip();
 
-                    // ATTENTION: WILL INSERT JIT_DET_FLAG HERE TO CHECK & COMPILE & INVOKE JIT CODE
-                    if (config::ENABLE_JUST_IN_TIME)
-                    {
-                        wo_error("JIT-MODULE HAS BEEN REMOVED");
-                    }
+                        }
 
-                    auto res_ip = compiler->reserved_stackvalue();                      // reserved..
+                        compiler->pdb_info->generate_func_begin(funcdef, compiler);
 
-                    // apply args.
-                    int arg_count = 0;
-                    auto arg_index = funcdef->argument_list->children;
-                    while (arg_index)
-                    {
-                        if (auto* a_value_arg_define = dynamic_cast<ast::ast_value_arg_define*>(arg_index))
+                        // ATTENTION: WILL INSERT JIT_DET_FLAG HERE TO CHECK & COMPILE & INVOKE JIT CODE
+                        if (config::ENABLE_JUST_IN_TIME)
                         {
-                            if (a_value_arg_define->decl == ast::identifier_decl::REF
-                                || a_value_arg_define->decl == ast::identifier_decl::IMMUTABLE)
-                            {
-                                funcdef->this_func_scope->
-                                    reduce_function_used_stack_size_at(a_value_arg_define->symbol->stackvalue_index_in_funcs);
+                            wo_error("JIT-MODULE HAS BEEN REMOVED");
+                        }
 
-                                wo_assert(0 == a_value_arg_define->symbol->stackvalue_index_in_funcs);
-                                a_value_arg_define->symbol->stackvalue_index_in_funcs = -2 - arg_count - (wo_integer_t)funcdef->capture_variables.size();
+                        auto res_ip = compiler->reserved_stackvalue();                      // reserved..
 
-                            }
-                            else
+                        // apply args.
+                        int arg_count = 0;
+                        auto arg_index = funcdef->argument_list->children;
+                        while (arg_index)
+                        {
+                            if (auto* a_value_arg_define = dynamic_cast<ast::ast_value_arg_define*>(arg_index))
                             {
-                                wo_integer_t stoffset = +2 + arg_count + (int8_t)funcdef->capture_variables.size();
-                                if (stoffset >= -64 && stoffset <= 63)
+                                if (a_value_arg_define->decl == ast::identifier_decl::REF
+                                    || a_value_arg_define->decl == ast::identifier_decl::IMMUTABLE)
                                 {
-                                    compiler->set(get_opnum_by_symbol(a_value_arg_define, a_value_arg_define->symbol, compiler),
-                                        opnum::reg(opnum::reg::bp_offset((int8_t)stoffset)));
+                                    funcdef->this_func_scope->
+                                        reduce_function_used_stack_size_at(a_value_arg_define->symbol->stackvalue_index_in_funcs);
+
+                                    wo_assert(0 == a_value_arg_define->symbol->stackvalue_index_in_funcs);
+                                    a_value_arg_define->symbol->stackvalue_index_in_funcs = -2 - arg_count - (wo_integer_t)funcdef->capture_variables.size();
+
                                 }
                                 else
-                                    compiler->lds(get_opnum_by_symbol(a_value_arg_define, a_value_arg_define->symbol, compiler),
-                                        opnum::imm(stoffset));
+                                {
+                                    wo_integer_t stoffset = +2 + arg_count + (int8_t)funcdef->capture_variables.size();
+                                    if (stoffset >= -64 && stoffset <= 63)
+                                    {
+                                        compiler->set(get_opnum_by_symbol(a_value_arg_define, a_value_arg_define->symbol, compiler),
+                                            opnum::reg(opnum::reg::bp_offset((int8_t)stoffset)));
+                                    }
+                                    else
+                                        compiler->lds(get_opnum_by_symbol(a_value_arg_define, a_value_arg_define->symbol, compiler),
+                                            opnum::imm(stoffset));
+                                }
                             }
+                            else//variadic
+                                break;
+                            arg_count++;
+                            arg_index = arg_index->sibling;
                         }
-                        else//variadic
-                            break;
-                        arg_count++;
-                        arg_index = arg_index->sibling;
-                    }
-                    real_analyze_finalize(funcdef->in_function_sentence, compiler);
+                        real_analyze_finalize(funcdef->in_function_sentence, compiler);
+                        compiler->optimize_pure_values(funcbegin_ip);
 
-                    auto temp_reg_to_stack_count = compiler->update_all_temp_regist_to_stack(funcbegin_ip);
-                    auto reserved_stack_size =
-                        funcdef->this_func_scope->max_used_stack_size_in_func
-                        + temp_reg_to_stack_count;
+                        auto temp_reg_to_stack_count = compiler->update_all_temp_regist_to_stack(funcbegin_ip);
+                        auto reserved_stack_size =
+                            funcdef->this_func_scope->max_used_stack_size_in_func
+                            + temp_reg_to_stack_count;
 
-                    compiler->reserved_stackvalue(res_ip, (uint16_t)reserved_stack_size); // set reserved size
+                        compiler->reserved_stackvalue(res_ip, (uint16_t)reserved_stack_size); // set reserved size
 
-                    compiler->pdb_info->generate_debug_info_at_funcend(funcdef, compiler);
+                        compiler->pdb_info->generate_debug_info_at_funcend(funcdef, compiler);
 
-                    compiler->tag(funcdef->get_ir_func_signature_tag() + "_do_ret");
-                    compiler->set(opnum::reg(opnum::reg::cr), opnum::reg(opnum::reg::ni));
-                    // compiler->pop(reserved_stack_size);
-                    if (funcdef->is_closure_function())
-                        compiler->ret((uint16_t)funcdef->capture_variables.size());
-                    else
-                        compiler->ret();                                            // do return
+                        compiler->tag(funcdef->get_ir_func_signature_tag() + "_do_ret");
+                        compiler->set(opnum::reg(opnum::reg::cr), opnum::reg(opnum::reg::ni));
+                        // compiler->pop(reserved_stack_size);
+                        if (funcdef->is_closure_function())
+                            compiler->ret((uint16_t)funcdef->capture_variables.size());
+                        else
+                            compiler->ret();                                            // do return
 
-                    compiler->pdb_info->generate_func_end(funcdef, temp_reg_to_stack_count, compiler);
+                        compiler->pdb_info->generate_func_end(funcdef, temp_reg_to_stack_count, compiler);
 
-                    if (config::ENABLE_JUST_IN_TIME)
-                        compiler->ext_endjit(); // ATTENTION: WILL INSERT JIT_DET_FLAG HERE TO CHECK & COMPILE & INVOKE JIT CODE
-                    else
-                        compiler->nop();
+                        if (config::ENABLE_JUST_IN_TIME)
+                            compiler->ext_endjit(); // ATTENTION: WILL INSERT JIT_DET_FLAG HERE TO CHECK & COMPILE & INVOKE JIT CODE
+                        else
+                            compiler->nop();
+
+                        for (auto funcvar : funcdef->this_func_scope->in_function_symbols)
+                            compiler->pdb_info->add_func_variable(funcdef, funcvar->name, funcvar->variable_value->row_no, funcvar->stackvalue_index_in_funcs);
+
+                    }
+                }
+            };
+            generate_in_used_functions(compiler);
+
+            // Named functions which never be referenced by reachable code are not needed in runtime,
+            // compile them by a discarded compiler, only for reporting errors in them.
+            std::vector<ast::ast_value_function_define*> eliminated_functions;
+            for (auto* funcdef : maybe_unused_functions)
+            {
+                if (!funcdef->ir_func_has_been_generated)
+                {
+                    funcdef->ir_func_has_been_generated = true;
+                    in_used_functions.push_back(funcdef);
+                    eliminated_functions.push_back(funcdef);
+                }
+            }
+            if (!eliminated_functions.empty())
+            {
+                ir_compiler unreachable_function_compiler;
+                generate_in_used_functions(&unreachable_function_compiler);
 
-                    for (auto funcvar : funcdef->this_func_scope->in_function_symbols)
-                        compiler->pdb_info->add_func_variable(funcdef, funcvar->name, funcvar->variable_value->row_no, funcvar->stackvalue_index_in_funcs);
+                if (config::ENABLE_OUTPUT_ELIMINATED_FUNCTION_INFO && !has_compile_error())
+                {
+                    unreachable_function_compiler.end();
+                    auto eliminated_env = unreachable_function_compiler.finalize();
 
+                    wo_stdout << ANSI_HIG "Woolang: " ANSI_RST "eliminated " << eliminated_functions.size()
+                        << " unreachable function(s), " << eliminated_env->rt_code_len << " byte(s) of code and "
+                        << eliminated_env->constant_value_count << " constant(s) saved." << wo_endl;
+                    for (auto* funcdef : eliminated_functions)
+                    {
+                        auto&& spacename = funcdef->get_namespace_chain();
+                        wo_stdout << "\t" << (spacename.empty() ? "" : spacename + "::") << wstr_to_str(funcdef->function_name) << wo_endl;
+                    }
                 }
             }
             compiler->tag("__rsir_rtcode_seg_function_define_end");
@@ -6538,6 +7027,22 @@ namespace wo
             }
             if (result)
             {
+                if (!var_ident->is_auto_judge_function_overload)
+                {
+                    if (result->define_in_function
+                        && dynamic_cast<ast::ast_value_function_define*>(result->variable_value))
+                    {
+                        // Closure which only be passed to specialized higher-order functions
+                        // can still be called directly, check it in finalize.
+                        auto& referenced_variables = result->value_referenced_variables;
+                        if (std::find(referenced_variables.begin(), referenced_variables.end(), var_ident)
+                            == referenced_variables.end())
+                            referenced_variables.push_back(var_ident);
+                    }
+                    else
+                        result->is_used_as_value = true;
+                }
+
                 auto symb_defined_in_func = result->defined_in_scope;
                 while (symb_defined_in_func->parent_scope &&
                     symb_defined_in_func->type != wo::lang_scope::scope_type::function_scope)
@@ -6585,6 +7090,8 @@ namespace wo
                     auto& capture_list = current_function->function_node->capture_variables;
                     if (std::find(capture_list.begin(), capture_list.end(), result) == capture_list.end())
                     {
+                        // Captured value will be used to make closure.
+                        result->is_used_as_value = true;
                         capture_list.push_back(result);
                         // Define a closure symbol instead of current one.
                         var_ident->symbol = result = define_variable_in_this_scope(result->name, result->variable_value, result->attribute, template_style::NORMAL, capture_list.size() - 1);
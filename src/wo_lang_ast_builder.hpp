@@ -788,7 +788,7 @@ namespace wo
             bool can_be_assign = false;
 
             bool is_constant = false;
-            wo::value constant_value;
+            wo::value constant_value = {};
 
             ast_value& operator = (ast_value&&) = delete;
             ast_value& operator = (const ast_value&) = default;
@@ -851,8 +851,7 @@ namespace wo
             {
                 if (auto* gcunit = constant_value.get_gcunit_with_barrier())
                 {
-                    gcunit->~gcbase();
-                    free64(gcunit);
+                    gcbase::gc_delete(gcunit);
                 }
             }
             void update_constant_value(lexer* lex) override
@@ -1406,6 +1405,7 @@ namespace wo
             std::vector<ast_type*> template_reification_args;
             bool directed_function_call = false;
             bool is_auto_judge_function_overload = false;
+            bool is_specialized_functor = false;
             ast_value_variable(const std::wstring& _var_name)
             {
                 var_name = _var_name;
@@ -1437,6 +1437,7 @@ namespace wo
                 if (!child_instance) *dumm = *this;
                 ast_value_symbolable_base::instance(dumm);
                 // Write self copy functions here..
+                dumm->is_specialized_functor = false;
 
                 for (auto& tras : dumm->template_reification_args)
                 {
@@ -1886,6 +1887,10 @@ namespace wo
             std::wstring load_from_lib;
             std::wstring symbol_name;
 
+            // extern("symbol", pure): The function only reads its arguments (and the values
+            //  they refer to), it will not change anything and result only depends on them.
+            bool is_pure = false;
+
             void display(std::wostream& os = std::wcout, size_t lay = 0) const override
             {
                 space(os, lay);
@@ -1894,6 +1899,11 @@ namespace wo
                 os << L"symbol: '" << symbol_name << "'" << std::endl;
                 space(os, lay);
                 os << L"from: '" << load_from_lib << "'" << std::endl;
+                if (is_pure)
+                {
+                    space(os, lay);
+                    os << L"pure" << std::endl;
+                }
             }
 
             grammar::ast_base* instance(ast_base* child_instance = nullptr) const override
@@ -3307,6 +3317,9 @@ namespace wo
             ast_pattern_union_value* union_pattern;
             ast_value_takeplace* take_place_value_may_nil;
 
+            // If not empty, match dispatched by jump table, and this case begin at this tag.
+            std::string case_begin_tag_in_final_pass;
+
             grammar::ast_base* instance(ast_base* child_instance = nullptr) const override
             {
                 using astnode_type = decltype(MAKE_INSTANCE(this));
@@ -3770,7 +3783,29 @@ namespace wo
             static std::any build(lexer& lex, const std::wstring& name, inputs_t& input)
             {
                 ast_extern_info* extern_symb = new ast_extern_info;
-                if (input.size() == 4)
+
+                size_t attrib_index = 0;
+                if (input.size() == 8)
+                {
+                    // extern ( lib , symb , attrib )
+                    attrib_index = 6;
+                }
+                else if (input.size() == 6 && WO_NEED_TOKEN(4).type == +lex_type::l_identifier)
+                {
+                    // extern ( symb , attrib )
+                    attrib_index = 4;
+                }
+
+                if (attrib_index)
+                {
+                    auto attrib = WO_NEED_TOKEN(attrib_index).identifier;
+                    if (attrib == L"pure")
+                        extern_symb->is_pure = true;
+                    else
+                        lex.parser_error(0x0000, WO_ERR_UNKNOWN_EXTERN_ATTRIB, attrib.c_str());
+                }
+
+                if (input.size() == 4 || attrib_index == 4)
                 {
                     extern_symb->symbol_name = WO_NEED_TOKEN(2).identifier;
                     extern_symb->externed_func =
@@ -3780,7 +3815,7 @@ namespace wo
                     if (!extern_symb->externed_func)
                         lex.parser_error(0x0000, WO_ERR_CANNOT_FIND_EXT_SYM, extern_symb->symbol_name.c_str());
                 }
-                else if (input.size() == 6)
+                else if (input.size() == 6 || input.size() == 8)
                 {
                     // extern ( lib , symb )
                     extern_symb->load_from_lib = WO_NEED_TOKEN(2).identifier;
@@ -4946,6 +4981,21 @@ namespace wo
 
                 afor->used_iter_define->var_refs.push_back({ afor_iter_define, exp_dir_iter_call });
 
+                // var _iter_index = -1; used for iterating array directly, see ast_foreach finalize.
+                auto* afor_iter_index_define = new ast_pattern_identifier;
+                afor_iter_index_define->identifier = L"_iter_index";
+                afor_iter_index_define->decl = identifier_decl::MUTABLE;
+                afor_iter_index_define->attr = new ast_decl_attribute();
+
+                ast_value_literal* iter_index_init = new ast_value_literal();
+                iter_index_init->value_type = new ast_type(L"int");
+                iter_index_init->constant_value.set_integer(-1);
+                iter_index_init->source_file = be_iter_value->source_file;
+                iter_index_init->row_no = be_iter_value->row_no;
+                iter_index_init->col_no = be_iter_value->col_no;
+
+                afor->used_iter_define->var_refs.push_back({ afor_iter_index_define, iter_index_init });
+
 
                 afor->used_vawo_defines = new ast_varref_defines;
                 afor->used_vawo_defines->declear_attribute = new ast_decl_attribute;
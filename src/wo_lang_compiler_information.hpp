@@ -62,6 +62,8 @@
 
 #define WO_ERR_CANNOT_FIND_EXT_SYM_IN_LIB L"无法找到外部符号: '%ls' 位于 '%ls'"
 
+#define WO_ERR_UNKNOWN_EXTERN_ATTRIB L"未知的外部函数属性: '%ls'"
+
 #define WO_ERR_ARG_DEFINE_AFTER_VARIADIC L"在 '...' 之后不应该有其他参数"
 
 #define WO_ERR_CANNOT_CALC_STR_WITH_THIS_OP L"不支持对字符串进行该运算"
@@ -271,6 +273,8 @@
 
 #define WO_ERR_CANNOT_FIND_EXT_SYM_IN_LIB L"Cannot find extern symbol: '%ls' in '%ls'"
 
+#define WO_ERR_UNKNOWN_EXTERN_ATTRIB L"Unknown extern function attribute: '%ls'."
+
 #define WO_ERR_ARG_DEFINE_AFTER_VARIADIC L"There should be no argument after '...'."
 
 #define WO_ERR_CANNOT_CALC_STR_WITH_THIS_OP L"Unsupported string operations."
@@ -301,6 +301,22 @@ namespace wo
                                     gm::te(gm::ttype::l_literal_string),
                                 gm::te(gm::ttype::l_right_brackets) }
                 >> WO_ASTBUILDER_INDEX(ast::pass_extern),
+                gm::nt(L"EXTERN_FROM") >> gm::symlist{ gm::te(gm::ttype::l_extern),
+                                gm::te(gm::ttype::l_left_brackets),
+                                    gm::te(gm::ttype::l_literal_string),
+                                    gm::te(gm::ttype::l_comma),
+                                    gm::te(gm::ttype::l_literal_string),
+                                    gm::te(gm::ttype::l_comma),
+                                    gm::te(gm::ttype::l_identifier),
+                                gm::te(gm::ttype::l_right_brackets) }
+                >> WO_ASTBUILDER_INDEX(ast::pass_extern),
+                gm::nt(L"EXTERN_FROM") >> gm::symlist{ gm::te(gm::ttype::l_extern),
+                                gm::te(gm::ttype::l_left_brackets),
+                                    gm::te(gm::ttype::l_literal_string),
+                                    gm::te(gm::ttype::l_comma),
+                                    gm::te(gm::ttype::l_identifier),
+                                gm::te(gm::ttype::l_right_brackets) }
+                >> WO_ASTBUILDER_INDEX(ast::pass_extern),
 
                 gm::nt(L"FUNC_DEFINE_WITH_NAME") >> gm::symlist{
                                     gm::nt(L"EXTERN_FROM"),
@@ -18,3 +18,248 @@ void _wo_aligned_free(void* memptr)
 	size_t originalPStorage = reinterpret_cast<size_t>(memptr) - sizeof(void*);
 	free(*reinterpret_cast<void**>(originalPStorage));
 }
+
+#include "wo_memory.hpp"
+
+#include <mutex>
+#include <vector>
+#include <atomic>
+
+#ifdef WO_PLATRORM_OS_WINDOWS
+#   include <Windows.h>
+#else
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+namespace wo
+{
+	namespace slab
+	{
+		constexpr size_t SLAB_SIZE = 64 * 1024;
+		// Blocks moved between thread buffer & global free list at once.
+		constexpr size_t TRANSFER_BLOCK_COUNT = 128;
+
+		struct free_block
+		{
+			free_block* next;
+		};
+
+		struct size_class_pool
+		{
+			std::mutex pool_mx;
+			free_block* free_list = nullptr;
+			size_t free_count = 0;
+		};
+
+		static size_class_pool& _get_size_class_pool(uint8_t size_class)
+		{
+			// NOTE: Slabs & pools will never be released, some gcunits (and thread buffers)
+			//       might still be alive after static variables destructed.
+			static size_class_pool* pools = new size_class_pool[SIZE_CLASS_COUNT];
+			return pools[size_class];
+		}
+
+		struct thread_alloc_buffer
+		{
+			free_block* free_lists[SIZE_CLASS_COUNT] = {};
+			size_t free_counts[SIZE_CLASS_COUNT] = {};
+
+			void give_back(uint8_t size_class, size_t count)
+			{
+				// Move 'count' blocks from this buffer to global pool.
+				free_block* head = free_lists[size_class];
+				free_block* tail = head;
+				for (size_t i = 1; i < count; ++i)
+					tail = tail->next;
+
+				free_lists[size_class] = tail->next;
+				free_counts[size_class] -= count;
+
+				auto& pool = _get_size_class_pool(size_class);
+				std::lock_guard g1(pool.pool_mx);
+				tail->next = pool.free_list;
+				pool.free_list = head;
+				pool.free_count += count;
+			}
+
+			void refill(uint8_t size_class)
+			{
+				auto& pool = _get_size_class_pool(size_class);
+				std::lock_guard g1(pool.pool_mx);
+
+				if (pool.free_list == nullptr)
+				{
+					// No free block, make a new slab.
+					const size_t block_size = (size_class + 1) * SIZE_CLASS_ALIGN;
+					char* slab_mem = (char*)alloc64(SLAB_SIZE);
+
+					for (size_t offset = 0; offset + block_size <= SLAB_SIZE; offset += block_size)
+					{
+						free_block* block = reinterpret_cast<free_block*>(slab_mem + offset);
+						block->next = pool.free_list;
+						pool.free_list = block;
+						++pool.free_count;
+					}
+				}
+
+				free_block* head = pool.free_list;
+				free_block* tail = head;
+				size_t count = 1;
+				for (; count < TRANSFER_BLOCK_COUNT && tail->next; ++count)
+					tail = tail->next;
+
+				pool.free_list = tail->next;
+				pool.free_count -= count;
+
+				tail->next = free_lists[size_class];
+				free_lists[size_class] = head;
+				free_counts[size_class] += count;
+			}
+
+			~thread_alloc_buffer()
+			{
+				for (uint8_t size_class = 0; size_class < SIZE_CLASS_COUNT; ++size_class)
+					if (free_counts[size_class])
+						give_back(size_class, free_counts[size_class]);
+			}
+		};
+
+		static thread_local thread_alloc_buffer _thread_alloc_buffer;
+
+		void* alloc_from_size_class(uint8_t size_class)
+		{
+			auto& tlab = _thread_alloc_buffer;
+			if (tlab.free_lists[size_class] == nullptr)
+				tlab.refill(size_class);
+
+			free_block* block = tlab.free_lists[size_class];
+			tlab.free_lists[size_class] = block->next;
+			--tlab.free_counts[size_class];
+
+			return block;
+		}
+		void free_to_size_class(void* ptr, uint8_t size_class)
+		{
+			auto& tlab = _thread_alloc_buffer;
+
+			free_block* block = reinterpret_cast<free_block*>(ptr);
+			block->next = tlab.free_lists[size_class];
+			tlab.free_lists[size_class] = block;
+
+			// Too many blocks cached by this thread (usually the gc-thread), give them back.
+			if (++tlab.free_counts[size_class] >= 2 * TRANSFER_BLOCK_COUNT)
+				tlab.give_back(size_class, TRANSFER_BLOCK_COUNT);
+		}
+	}
+
+	namespace los
+	{
+		// Freed regions are cached (pages have been given back to os), so that buffers
+		// grown by same steps can reuse the address space.
+		constexpr size_t MAX_CACHED_REGION_COUNT = 16;
+
+		struct cached_region
+		{
+			void* ptr;
+			size_t mapped_size;
+		};
+
+		std::mutex _cached_regions_mx;
+		std::vector<cached_region> _cached_regions;
+
+		std::atomic_size_t _allocated_bytes = 0;
+		std::atomic_size_t _allocated_count = 0;
+
+		static size_t _page_size()
+		{
+#ifdef WO_PLATRORM_OS_WINDOWS
+			static const size_t page_size = []() {
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				return (size_t)info.dwPageSize; }();
+#else
+			static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+			return page_size;
+		}
+
+		static size_t _mapped_size_of(size_t memsz)
+		{
+			const size_t page_size = _page_size();
+			return (memsz + page_size - 1) / page_size * page_size;
+		}
+
+		void* alloc(size_t memsz)
+		{
+			const size_t mapped_size = _mapped_size_of(memsz);
+
+			_allocated_bytes += mapped_size;
+			++_allocated_count;
+
+			do
+			{
+				std::lock_guard g1(_cached_regions_mx);
+				for (auto& region : _cached_regions)
+				{
+					if (region.mapped_size == mapped_size)
+					{
+						void* ptr = region.ptr;
+						region = _cached_regions.back();
+						_cached_regions.pop_back();
+						return ptr;
+					}
+				}
+			} while (0);
+
+#ifdef WO_PLATRORM_OS_WINDOWS
+			void* ptr = VirtualAlloc(nullptr, mapped_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			if (ptr == nullptr)
+				throw std::bad_alloc();
+#else
+			void* ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (ptr == MAP_FAILED)
+				throw std::bad_alloc();
+#endif
+			return ptr;
+		}
+		void free(void* ptr, size_t memsz)
+		{
+			const size_t mapped_size = _mapped_size_of(memsz);
+
+			_allocated_bytes -= mapped_size;
+			--_allocated_count;
+
+			// Give pages back to os, but keep the address space for reusing.
+#ifdef WO_PLATRORM_OS_WINDOWS
+			VirtualAlloc(ptr, mapped_size, MEM_RESET, PAGE_READWRITE);
+#else
+			madvise(ptr, mapped_size, MADV_DONTNEED);
+#endif
+			do
+			{
+				std::lock_guard g1(_cached_regions_mx);
+				if (_cached_regions.size() < MAX_CACHED_REGION_COUNT)
+				{
+					_cached_regions.push_back({ ptr, mapped_size });
+					return;
+				}
+			} while (0);
+
+#ifdef WO_PLATRORM_OS_WINDOWS
+			VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+			munmap(ptr, mapped_size);
+#endif
+		}
+
+		size_t allocated_bytes()
+		{
+			return _allocated_bytes;
+		}
+		size_t allocated_count()
+		{
+			return _allocated_count;
+		}
+	}
+}
@@ -4,6 +4,7 @@
 #include <cstdlib>
 #include <cstddef>
 #include <new>
+#include <cstdint>
 
 void* _wo_aligned_alloc(size_t allocsz, size_t allign);
 void _wo_aligned_free(void* memptr);
@@ -18,4 +19,88 @@ namespace wo
     {
         _wo_aligned_free(ptr);
     }
+
+    // Size-class slab allocator, used for allocating gcunits.
+    // Memory is carved from cache-line-aligned slabs of each size class, every thread
+    // has it's own allocation buffer, so allocating & freeing needn't any lock in most case.
+    namespace slab
+    {
+        constexpr size_t SIZE_CLASS_ALIGN = 16;
+        constexpr size_t SIZE_CLASS_COUNT = 16;
+        // Objects larger than SIZE_CLASS_ALIGN * SIZE_CLASS_COUNT will be allocated by alloc64.
+        constexpr uint8_t LARGE_SIZE_CLASS = 0xFF;
+
+        constexpr uint8_t size_class_of(size_t memsz)
+        {
+            return memsz > SIZE_CLASS_ALIGN * SIZE_CLASS_COUNT
+                ? LARGE_SIZE_CLASS
+                : (uint8_t)((memsz + SIZE_CLASS_ALIGN - 1) / SIZE_CLASS_ALIGN - 1);
+        }
+
+        void* alloc_from_size_class(uint8_t size_class);
+        void free_to_size_class(void* ptr, uint8_t size_class);
+
+        inline void* alloc(size_t memsz, uint8_t size_class)
+        {
+            if (size_class == LARGE_SIZE_CLASS)
+                return alloc64(memsz);
+            return alloc_from_size_class(size_class);
+        }
+        inline void free(void* ptr, uint8_t size_class)
+        {
+            if (size_class == LARGE_SIZE_CLASS)
+                free64(ptr);
+            else
+                free_to_size_class(ptr, size_class);
+        }
+    }
+
+    // Large-object space, buffers of containers which are larger than config::GC_LARGE_OBJECT_SIZE
+    // are mapped from os directly, pages will be given back to os when they are freed.
+    namespace los
+    {
+        void* alloc(size_t memsz);
+        void free(void* ptr, size_t memsz);
+
+        // Bytes & count of buffers allocated in large-object space now.
+        size_t allocated_bytes();
+        size_t allocated_count();
+
+        inline bool is_large(size_t memsz)
+        {
+            return config::GC_LARGE_OBJECT_SIZE != 0 && memsz >= config::GC_LARGE_OBJECT_SIZE;
+        }
+
+        // Allocator of containers' buffer, large buffers will be allocated in large-object space.
+        template<typename T>
+        struct allocator
+        {
+            using value_type = T;
+
+            allocator() noexcept = default;
+            template<typename U>
+            allocator(const allocator<U>&) noexcept {}
+
+            T* allocate(size_t n)
+            {
+                const size_t memsz = n * sizeof(T);
+                if (is_large(memsz))
+                    return static_cast<T*>(los::alloc(memsz));
+                return static_cast<T*>(::operator new(memsz));
+            }
+            void deallocate(T* ptr, size_t n) noexcept
+            {
+                const size_t memsz = n * sizeof(T);
+                if (is_large(memsz))
+                    los::free(ptr, memsz);
+                else
+                    ::operator delete(ptr);
+            }
+
+            template<typename U>
+            bool operator == (const allocator<U>&) const noexcept { return true; }
+            template<typename U>
+            bool operator != (const allocator<U>&) const noexcept { return false; }
+        };
+    }
 }
\ No newline at end of file
@@ -4,11 +4,16 @@
 #include "wo_assert.hpp"
 #include "wo_env_locale.hpp"
 #include <string>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef _WIN32
 #include <Windows.h>
 #elif defined(__linux__)
 #include <dlfcn.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #elif defined(__APPLE__)
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
@@ -86,6 +91,36 @@ namespace wo
             dlclose(libhandle);
         }
 
+#endif
+
+#if defined(__linux__)
+        void futex_wait(std::atomic_uint32_t* addr, uint32_t expected)
+        {
+            static_assert(sizeof(std::atomic_uint32_t) == sizeof(uint32_t));
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+        }
+        void futex_wake_all(std::atomic_uint32_t* addr)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+        }
+#else
+        // No futex here, all waiters share one condition variable.
+        std::mutex _futex_mx;
+        std::condition_variable _futex_cv;
+
+        void futex_wait(std::atomic_uint32_t* addr, uint32_t expected)
+        {
+            std::unique_lock ug1(_futex_mx);
+            _futex_cv.wait(ug1, [=]() {return addr->load() != expected; });
+        }
+        void futex_wake_all(std::atomic_uint32_t* addr)
+        {
+            do
+            {
+                std::lock_guard g1(_futex_mx);
+            } while (0);
+            _futex_cv.notify_all();
+        }
 #endif
     }
 }
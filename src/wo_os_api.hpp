@@ -4,6 +4,9 @@
 #       include "wo.h"
 #endif
 
+#include <atomic>
+#include <cstdint>
+
 namespace wo
 {
     namespace osapi
@@ -11,5 +14,9 @@ namespace wo
         void* loadlib   (const char* dllpath, const char* scriptpath = nullptr);
         wo_native_func  loadfunc(void* libhandle, const char* funcname);
         void            freelib(void* libhandle);
+
+        // Sleep until *addr is not expected or be waked, might return spuriously.
+        void            futex_wait(std::atomic_uint32_t* addr, uint32_t expected);
+        void            futex_wake_all(std::atomic_uint32_t* addr);
     }
 }
\ No newline at end of file
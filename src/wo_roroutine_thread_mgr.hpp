@@ -150,9 +150,11 @@ namespace wo
         {
             auto _old_this_thread_vm = wo::vmbase::_this_thread_vm;
             wo::vmbase::_this_thread_vm = m_virtualmachine;
+            auto _old_thread_heap = wo::gcheap::switch_thread_heap(m_virtualmachine->gc_heap);
 
             m_fthread->invoke_from(from_fib);
 
+            wo::gcheap::switch_thread_heap(_old_thread_heap);
             wo::vmbase::_this_thread_vm = _old_this_thread_vm;
         }
 
@@ -160,9 +162,11 @@ namespace wo
         {
             auto _old_this_thread_vm = wo::vmbase::_this_thread_vm;
             wo::vmbase::_this_thread_vm = m_virtualmachine;
+            auto _old_thread_heap = wo::gcheap::switch_thread_heap(m_virtualmachine->gc_heap);
 
             m_fthread->join(from_fib);
 
+            wo::gcheap::switch_thread_heap(_old_thread_heap);
             wo::vmbase::_this_thread_vm = _old_this_thread_vm;
         }
 
@@ -170,10 +174,12 @@ namespace wo
         {
             auto _old_this_thread_vm = wo::vmbase::_this_thread_vm;
             wo::vmbase::_this_thread_vm = m_virtualmachine;
+            auto _old_thread_heap = wo::gcheap::switch_thread_heap(m_virtualmachine->gc_heap);
 
             m_virtualmachine->interrupt(vmbase::ABORT_INTERRUPT);
             m_fthread->join(from_fib);
 
+            wo::gcheap::switch_thread_heap(_old_thread_heap);
             wo::vmbase::_this_thread_vm = _old_this_thread_vm;
         }
 
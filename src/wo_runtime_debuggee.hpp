@@ -232,7 +232,8 @@ stepir          si                            Execute next command.
                         while (framelayer--)
                         {
                             auto tmp_sp = current_frame_bp + 1;
-                            if (tmp_sp->type == value::valuetype::callstack)
+                            if (tmp_sp->type == value::valuetype::callstack
+                                || tmp_sp->type == value::valuetype::barriercallstack)
                             {
                                 current_frame++;
                                 current_frame_sp = tmp_sp;
@@ -6,6 +6,9 @@ extern const char* wo_stdlib_src_data;
 extern const char* wo_stdlib_debug_src_path;
 extern const char* wo_stdlib_debug_src_data;
 
+extern const char* wo_stdlib_gc_src_path;
+extern const char* wo_stdlib_gc_src_data;
+
 extern const char* wo_stdlib_vm_src_path;
 extern const char* wo_stdlib_vm_src_data;
 
@@ -10,6 +10,8 @@
 #include <chrono>
 #include <random>
 #include <thread>
+#include <cstdio>
+#include <filesystem>
 
 WO_API wo_api rslib_std_print(wo_vm vm, wo_value args, size_t argc)
 {
@@ -687,12 +689,20 @@ WO_API wo_api rslib_std_thread_sleep(wo_vm vm, wo_value args, size_t argc)
 
 WO_API wo_api rslib_std_vm_create(wo_vm vm, wo_value args, size_t argc)
 {
-    return wo_ret_gchandle(vm,
+    wo_value result = wo_push_empty(vm);
+    wo_set_gchandle(result,
         wo_create_vm(),
         nullptr,
         [](void* vm_ptr) {
             wo_close_vm((wo_vm)vm_ptr);
         });
+    // Vm holds it's stack & compiled code, close it as soon as possible.
+    wo_gchandle_set_prompt(result);
+
+    wo_ret_val(vm, result);
+    wo_pop_stack(vm);
+
+    return 0;
 }
 
 WO_API wo_api rslib_std_vm_load_src(wo_vm vm, wo_value args, size_t argc)
@@ -764,6 +774,20 @@ WO_API wo_api rslib_std_get_exe_path(wo_vm vm, wo_value args, size_t argc)
     return wo_ret_string(vm, wo::exe_path());
 }
 
+WO_API wo_api rslib_std_get_temp_path(wo_vm vm, wo_value args, size_t argc)
+{
+    std::error_code ec;
+    auto temp_path = std::filesystem::temp_directory_path(ec);
+    if (ec)
+        return wo_ret_string(vm, "");
+    return wo_ret_string(vm, (temp_path / "").u8string().c_str());
+}
+
+WO_API wo_api rslib_std_remove_file(wo_vm vm, wo_value args, size_t argc)
+{
+    return wo_ret_bool(vm, 0 == std::remove(wo_string(args + 0)));
+}
+
 WO_API wo_api rslib_std_get_extern_symb(wo_vm vm, wo_value args, size_t argc)
 {
     wo_integer_t ext_symb = wo_extern_symb(vm, wo_string(args + 0));
@@ -881,6 +905,13 @@ namespace std
     extern("rslib_std_get_exe_path")
         func exepath()=>string;
 
+    // Temporary directory of os, end with path separator, empty if failed.
+    extern("rslib_std_get_temp_path")
+        func tmppath()=>string;
+
+    extern("rslib_std_remove_file")
+        func remove_file(path:string)=>bool;
+
     extern("rslib_std_get_extern_symb")
         func extern_symbol<T>(fullname:string)=> option<T>;
 
@@ -913,67 +944,67 @@ namespace std
 
 namespace string
 {
-    extern("rslib_std_lengthof") 
+    extern("rslib_std_lengthof", pure) 
         func len(val:string)=>int;
 
-    extern("rslib_std_sub")
+    extern("rslib_std_sub", pure)
         func sub(val:string, begin:int)=>string;
 
-    extern("rslib_std_sub")
+    extern("rslib_std_sub", pure)
         func sub(val:string, begin:int, length:int)=>string;
     
-    extern("rslib_std_string_toupper")
+    extern("rslib_std_string_toupper", pure)
         func upper(val:string)=>string;
 
-    extern("rslib_std_string_tolower")
+    extern("rslib_std_string_tolower", pure)
         func lower(val:string)=>string;
 
-    extern("rslib_std_string_isspace")
+    extern("rslib_std_string_isspace", pure)
         func isspace(val:string)=>bool;
 
-    extern("rslib_std_string_isalpha")
+    extern("rslib_std_string_isalpha", pure)
         func isalpha(val:string)=> bool;
 
-    extern("rslib_std_string_isalnum")
+    extern("rslib_std_string_isalnum", pure)
         func isalnum(val:string)=> bool;
 
-    extern("rslib_std_string_isnumber")
+    extern("rslib_std_string_isnumber", pure)
         func isnumber(val:string)=> bool;
 
-    extern("rslib_std_string_ishex")
+    extern("rslib_std_string_ishex", pure)
         func ishex(val:string)=> bool;
 
-    extern("rslib_std_string_isoct")
+    extern("rslib_std_string_isoct", pure)
         func isoct(val:string)=> bool;
 
-    extern("rslib_std_string_enstring")
+    extern("rslib_std_string_enstring", pure)
         func enstring(val:string)=>string;
 
-    extern("rslib_std_string_destring")
+    extern("rslib_std_string_destring", pure)
         func destring(val:string)=> string;
 
-    extern("rslib_std_string_beginwith")
+    extern("rslib_std_string_beginwith", pure)
         func beginwith(val:string, str:string)=> bool;
 
-    extern("rslib_std_string_endwith")
+    extern("rslib_std_string_endwith", pure)
         func endwith(val:string, str:string)=> bool;
 
-    extern("rslib_std_string_replace")
+    extern("rslib_std_string_replace", pure)
         func replace(val:string, match_aim:string, str:string)=> string;
 
-    extern("rslib_std_string_find")
+    extern("rslib_std_string_find", pure)
         func find(val:string, match_aim:string)=> int;
 
-    extern("rslib_std_string_find_from")
+    extern("rslib_std_string_find_from", pure)
         func find(val:string, match_aim:string, from: int)=> int;
 
-    extern("rslib_std_string_rfind")
+    extern("rslib_std_string_rfind", pure)
         func rfind(val:string, match_aim:string)=> int;
 
-    extern("rslib_std_string_rfind_from")
+    extern("rslib_std_string_rfind_from", pure)
         func rfind(val:string, match_aim:string, from: int)=> int;
 
-    extern("rslib_std_string_trim")
+    extern("rslib_std_string_trim", pure)
         func trim(val:string)=>string;
 
     func split(val:string, spliter:string)
@@ -987,13 +1018,13 @@ namespace string
 
 namespace array
 {
-    extern("rslib_std_lengthof") 
+    extern("rslib_std_lengthof", pure) 
         func len<T>(val: array<T>)=> int;
 
     extern("rslib_std_make_dup")
         func dup<T>(val: array<T>)=> array<T>;
 
-    extern("rslib_std_array_empty")
+    extern("rslib_std_array_empty", pure)
         func empty<T>(val: array<T>)=> bool;
 
     extern("rslib_std_array_resize") 
@@ -1013,7 +1044,7 @@ namespace array
     extern("rslib_std_array_remove")
         func remove<T>(val:array<T>, index:int)=>void;
 
-    extern("rslib_std_array_find")
+    extern("rslib_std_array_find", pure)
         func find<T>(val:array<T>, elem:T)=>int;
 
     extern("rslib_std_array_clear")
@@ -1060,22 +1091,22 @@ namespace array
 
 namespace map
 {
-    extern("rslib_std_lengthof") 
+    extern("rslib_std_lengthof", pure) 
         func len<KT, VT>(val: map<KT, VT>)=>int;
     extern("rslib_std_make_dup")
         func dup<KT, VT>(val: map<KT, VT>)=> map<KT, VT>;
-    extern("rslib_std_map_find") 
+    extern("rslib_std_map_find", pure) 
         func find<KT, VT>(val: map<KT, VT>, index: KT)=> bool;
     extern("rslib_std_map_only_get") 
         func get<KT, VT>(m: map<KT, VT>, index: KT)=> option<VT>;
-    extern("rslib_std_map_contain") 
+    extern("rslib_std_map_contain", pure) 
         func contain<KT, VT>(m: map<KT, VT>, index: KT)=>bool;
     extern("rslib_std_map_get_by_default") 
         func get<KT, VT>(m: map<KT, VT>, index: KT, default_val: VT)=>VT;
     extern("rslib_std_map_get_or_default") 
         func get_or_default<KT, VT>(m: map<KT, VT>, index: KT, default_val: VT)=> VT;
 
-    extern("rslib_std_map_empty")
+    extern("rslib_std_map_empty", pure)
         func empty<KT, VT>(val: map<KT, VT>)=> bool;
 
     extern("rslib_std_map_remove")
@@ -1194,6 +1225,289 @@ namespace std
 }
 )" };
 
+WO_API wo_api rslib_std_gc_collect(wo_vm vm, wo_value args, size_t argc)
+{
+    wo_gc_immediately();
+    return wo_ret_void(vm);
+}
+
+WO_API wo_api rslib_std_gc_dump_snapshot(wo_vm vm, wo_value args, size_t argc)
+{
+    return wo_ret_bool(vm, wo_gc_dump_heap_snapshot(wo_string(args + 0)));
+}
+
+WO_API wo_api rslib_std_gc_set_memory_quota(wo_vm vm, wo_value args, size_t argc)
+{
+    wo_gc_set_memory_quota(vm, (size_t)wo_int(args + 0));
+    return wo_ret_void(vm);
+}
+
+WO_API wo_api rslib_std_gc_memory_used(wo_vm vm, wo_value args, size_t argc)
+{
+    return wo_ret_int(vm, (wo_int_t)wo_gc_get_memory_used(vm));
+}
+
+WO_API wo_api rslib_std_weakref_create(wo_vm vm, wo_value args, size_t argc)
+{
+    wo_value result = wo_push_empty(vm);
+    wo_set_gchandle(result, nullptr, nullptr, nullptr);
+
+    wo::gc_handle_base_t* handle = reinterpret_cast<wo::value*>(result)->get()->gchandle;
+    // Weakly held value is not counted, so counted gchandle will be closed when dropped.
+    handle->holding_value = *reinterpret_cast<wo::value*>(args + 0)->get();
+    handle->set_weak(wo::gc_handle_base_t::weak_type::weak_value);
+
+    wo_ret_val(vm, result);
+    wo_pop_stack(vm);
+
+    return 0;
+}
+
+WO_API wo_api rslib_std_weakref_get(wo_vm vm, wo_value args, size_t argc)
+{
+    wo::gc_handle_base_t* handle = reinterpret_cast<wo::value*>(args + 0)->get()->gchandle;
+
+    wo_value result = wo_push_empty(vm);
+    if (handle->get_weak_value(reinterpret_cast<wo::value*>(result)))
+        wo_ret_option_val(vm, result);
+    else
+        wo_ret_option_none(vm);
+    wo_pop_stack(vm);
+
+    return 0;
+}
+
+WO_API wo_api rslib_std_weakmap_create(wo_vm vm, wo_value args, size_t argc)
+{
+    wo_value result = wo_push_empty(vm);
+    wo_set_gchandle(result, new wo::gc_handle_base_t::weak_keyed_map_t, nullptr,
+        [](void* weak_map_ptr)
+        {
+            delete (wo::gc_handle_base_t::weak_keyed_map_t*)weak_map_ptr;
+        });
+
+    wo::gc_handle_base_t* handle = reinterpret_cast<wo::value*>(result)->get()->gchandle;
+    handle->set_weak(wo::gc_handle_base_t::weak_type::weak_keyed_map);
+
+    wo_ret_val(vm, result);
+    wo_pop_stack(vm);
+
+    return 0;
+}
+
+WO_API wo_api rslib_std_weakmap_set(wo_vm vm, wo_value args, size_t argc)
+{
+    wo::gchandle_t* handle = reinterpret_cast<wo::value*>(args + 0)->get()->gchandle;
+
+    wo::gcbase::gc_write_guard g1(handle);
+    if (handle->has_been_closed)
+        return wo_ret_panic(vm, "Weak map has been closed.");
+
+    auto* weak_map = static_cast<wo::gc_handle_base_t::weak_keyed_map_t*>(handle->holding_handle);
+    wo::value& val = (*weak_map)[*reinterpret_cast<wo::value*>(args + 1)->get()];
+    if (wo::gc::gc_is_marking())
+        handle->add_memo(&val);
+    val.set_val(reinterpret_cast<wo::value*>(args + 2)->get());
+
+    return wo_ret_void(vm);
+}
+
+WO_API wo_api rslib_std_weakmap_get(wo_vm vm, wo_value args, size_t argc)
+{
+    wo::gchandle_t* handle = reinterpret_cast<wo::value*>(args + 0)->get()->gchandle;
+
+    wo::gcbase::gc_read_guard g1(handle);
+    if (handle->has_been_closed)
+        return wo_ret_panic(vm, "Weak map has been closed.");
+
+    auto* weak_map = static_cast<wo::gc_handle_base_t::weak_keyed_map_t*>(handle->holding_handle);
+    auto fnd = weak_map->find(*reinterpret_cast<wo::value*>(args + 1)->get());
+    if (fnd != weak_map->end())
+    {
+        if (wo::gc::gc_is_marking())
+            handle->add_memo(&fnd->second);
+        return wo_ret_option_val(vm, reinterpret_cast<wo_value>(&fnd->second));
+    }
+    return wo_ret_option_none(vm);
+}
+
+WO_API wo_api rslib_std_weakmap_remove(wo_vm vm, wo_value args, size_t argc)
+{
+    wo::gchandle_t* handle = reinterpret_cast<wo::value*>(args + 0)->get()->gchandle;
+
+    wo::gcbase::gc_write_guard g1(handle);
+    if (handle->has_been_closed)
+        return wo_ret_panic(vm, "Weak map has been closed.");
+
+    auto* weak_map = static_cast<wo::gc_handle_base_t::weak_keyed_map_t*>(handle->holding_handle);
+    auto fnd = weak_map->find(*reinterpret_cast<wo::value*>(args + 1)->get());
+    if (fnd != weak_map->end())
+    {
+        if (wo::gc::gc_is_marking())
+            handle->add_memo(&fnd->second);
+        weak_map->erase(fnd);
+        return wo_ret_bool(vm, true);
+    }
+    return wo_ret_bool(vm, false);
+}
+
+WO_API wo_api rslib_std_weakmap_len(wo_vm vm, wo_value args, size_t argc)
+{
+    wo::gchandle_t* handle = reinterpret_cast<wo::value*>(args + 0)->get()->gchandle;
+
+    wo::gcbase::gc_read_guard g1(handle);
+    if (handle->has_been_closed)
+        return wo_ret_panic(vm, "Weak map has been closed.");
+
+    auto* weak_map = static_cast<wo::gc_handle_base_t::weak_keyed_map_t*>(handle->holding_handle);
+    return wo_ret_int(vm, (wo_int_t)weak_map->size());
+}
+
+WO_API wo_api rslib_std_gc_stats(wo_vm vm, wo_value args, size_t argc)
+{
+    wo_gc_stats stats;
+    wo_gc_get_stats(&stats);
+
+    wo_value result = wo_push_empty(vm);
+    wo_set_struct(result, 30);
+
+    uint16_t offset = 0;
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.cycle_count);
+    wo_set_bool(wo_struct_get(result, offset++), stats.is_minor_collect);
+    wo_set_real(wo_struct_get(result, offset++), stats.pause_time);
+    wo_set_real(wo_struct_get(result, offset++), stats.max_pause_time);
+    wo_set_real(wo_struct_get(result, offset++), stats.total_pause_time);
+    wo_set_real(wo_struct_get(result, offset++), stats.max_time_to_safepoint);
+    wo_set_real(wo_struct_get(result, offset++), stats.avg_time_to_safepoint);
+    wo_set_real(wo_struct_get(result, offset++), stats.max_time_to_resume);
+    wo_set_real(wo_struct_get(result, offset++), stats.avg_time_to_resume);
+    wo_set_real(wo_struct_get(result, offset++), stats.mark_time);
+    wo_set_real(wo_struct_get(result, offset++), stats.sweep_time);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.eden_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.eden_bytes);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.young_live_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.young_live_bytes);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.young_freed_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.young_freed_bytes);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.promoted_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.promoted_bytes);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.old_live_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.old_live_bytes);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.old_freed_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.old_freed_bytes);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.memo_record_count);
+    wo_set_real(wo_struct_get(result, offset++), stats.allocate_rate);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.large_object_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.large_object_bytes);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.finalizer_backlog_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.finalized_count);
+    wo_set_int(wo_struct_get(result, offset++), (wo_int_t)stats.prompt_handle_count);
+
+    wo_ret_val(vm, result);
+    wo_pop_stack(vm);
+
+    return 0;
+}
+
+const char* wo_stdlib_gc_src_path = u8"woo/gc.wo";
+const char* wo_stdlib_gc_src_data = {
+u8R"(
+import woo.std;
+namespace std
+{
+    namespace gc
+    {
+        // Time is in seconds, counts & bytes are of last gc round.
+        using stats = struct {
+            cycle_count: int,
+            is_minor_collect: bool,
+
+            pause_time: real,
+            max_pause_time: real,
+            total_pause_time: real,
+            max_time_to_safepoint: real,
+            avg_time_to_safepoint: real,
+            max_time_to_resume: real,
+            avg_time_to_resume: real,
+            mark_time: real,
+            sweep_time: real,
+
+            eden_count: int,
+            eden_bytes: int,
+            young_live_count: int,
+            young_live_bytes: int,
+            young_freed_count: int,
+            young_freed_bytes: int,
+            promoted_count: int,
+            promoted_bytes: int,
+            old_live_count: int,
+            old_live_bytes: int,
+            old_freed_count: int,
+            old_freed_bytes: int,
+
+            memo_record_count: int,
+            allocate_rate: real,
+
+            large_object_count: int,
+            large_object_bytes: int,
+
+            finalizer_backlog_count: int,
+            finalized_count: int,
+            prompt_handle_count: int
+        };
+
+        extern("rslib_std_gc_stats")
+            func get_stats()=> stats;
+
+        extern("rslib_std_gc_collect")
+            func collect()=> void;
+
+        extern("rslib_std_gc_dump_snapshot")
+            func dump_snapshot(path: string)=> bool;
+
+        // Bytes of units & their containers in the heap of current vm, vm allocating more than
+        // quota will fail, 0 means no limit.
+        extern("rslib_std_gc_set_memory_quota")
+            func set_memory_quota(max_bytes: int)=> void;
+
+        extern("rslib_std_gc_memory_used")
+            func memory_used()=> int;
+    }
+
+    // Value held by weakref will not be kept alive, get will return none after it collected.
+    using weakref<T> = gchandle;
+    namespace weakref
+    {
+        extern("rslib_std_weakref_create")
+            func create<T>(val: T)=> weakref<T>;
+
+        extern("rslib_std_weakref_get")
+            func get<T>(self: weakref<T>)=> option<T>;
+    }
+
+    // Keys of weakmap are weakly held, entries will be removed after their keys collected.
+    // Values are strongly held, so value referencing it's key will keep the entry alive.
+    using weakmap<KT, VT> = gchandle;
+    namespace weakmap
+    {
+        extern("rslib_std_weakmap_create")
+            func create<KT, VT>()=> weakmap<KT, VT>;
+
+        extern("rslib_std_weakmap_set")
+            func set<KT, VT>(self: weakmap<KT, VT>, key: KT, val: VT)=> void;
+
+        extern("rslib_std_weakmap_get")
+            func get<KT, VT>(self: weakmap<KT, VT>, key: KT)=> option<VT>;
+
+        extern("rslib_std_weakmap_remove")
+            func remove<KT, VT>(self: weakmap<KT, VT>, key: KT)=> bool;
+
+        extern("rslib_std_weakmap_len")
+            func len<KT, VT>(self: weakmap<KT, VT>)=> int;
+    }
+}
+)" };
+
 const char* wo_stdlib_vm_src_path = u8"woo/vm.wo";
 const char* wo_stdlib_vm_src_data = {
 u8R"(
@@ -1253,6 +1567,10 @@ struct wo_thread_pack
 
 WO_API wo_api rslib_std_thread_create(wo_vm vm, wo_value args, size_t argc)
 {
+#ifdef WO_SINGLE_THREADED
+    // Locks & barriers of gc are removed in single-threaded build, vms cannot run in other threads.
+    return wo_ret_halt(vm, "std::thread is not supported in single-threaded build.");
+#endif
     wo_vm new_thread_vm = wo_sub_vm(vm, reinterpret_cast<wo::vmbase*>(vm)->stack_size);
 
     wo_value wo_calling_function = wo_push_valref(new_thread_vm, args);
@@ -1482,6 +1800,10 @@ struct wo_co_waitable : wo_co_waitable_base
 
 WO_API wo_api rslib_std_roroutine_launch(wo_vm vm, wo_value args, size_t argc)
 {
+#ifdef WO_SINGLE_THREADED
+    // Coroutines are run by scheduler threads, see rslib_std_thread_create.
+    return wo_ret_halt(vm, "Coroutine is not supported in single-threaded build.");
+#endif
     // rslib_std_roroutine_launch(...)   
     auto* _nvm = RSCO_WorkerPool::get_usable_vm(reinterpret_cast<wo::vmbase*>(vm));
     wo_int_t arg_count = 0;
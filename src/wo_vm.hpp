@@ -7,6 +7,7 @@
 #include "wo_memory.hpp"
 #include "wo_compiler_jit.hpp"
 #include "wo_exceptions.hpp"
+#include "wo_os_api.hpp"
 
 #include <csetjmp>
 #include <shared_mutex>
@@ -16,6 +17,7 @@
 #include <string>
 #include <cmath>
 #include <sstream>
+#include <chrono>
 
 namespace wo
 {
@@ -64,6 +66,14 @@ namespace wo
         inline thread_local static vmbase* _this_thread_vm = nullptr;
         inline static std::atomic_uint32_t _alive_vm_count_for_gc_vm_destruct;
 
+        // Hanged-up vms sleep on this epoch, gc resumes all of them at once by increasing it,
+        // see hangup & resume_hanged_vms.
+        inline static std::atomic_uint32_t _vm_hang_epoch;
+        inline static std::atomic_int64_t _vm_resume_begin_time;
+        inline static std::atomic_int64_t _vm_max_resume_time;
+        inline static std::atomic_int64_t _vm_total_resume_time;
+        inline static std::atomic_uint64_t _vm_resumed_count;
+
         enum class jit_state : byte_t
         {
             NONE = 0,
@@ -92,7 +102,8 @@ namespace wo
             // vm should call 'hangup' to wait for GC work. 
             // GC work will cancel GC_INTERRUPT after collect_stage_1. if cancel
             // failed, it means vm already hangned(or trying hangs now), GC work
-            // will call 'wakeup' to resume vm.
+            // will call 'wakeup' to resume vm, and 'resume_hanged_vms' to wake all
+            // of them at once.
 
             LEAVE_INTERRUPT = 1 << 9,
             // When GC work trying GC_INTERRUPT, it will wait for vm cleaning 
@@ -131,6 +142,14 @@ namespace wo
             // VM will yield & return from running-state while received BR_YIELD_INTERRUPT
 
             EXCEPTION_ROLLBACK_INTERRUPT = 1 << 15,
+
+            MEMORY_QUOTA_INTERRUPT = 1 << 16,
+            // VM will wait for gc when bytes of it's heap exceed the quota, and fail with
+            // WO_FAIL_MEMORY_QUOTA if they still exceed after collected, see gcheap::m_memory_quota.
+
+            RELEASED_HANDLE_INTERRUPT = 1 << 17,
+            // Counted gchandles released by running vm will be closed at safepoint with
+            // LEAVE_INTERRUPT, see gc_handle_base_t::release_reference.
         };
 
         vmbase(const vmbase&) = delete;
@@ -156,8 +175,6 @@ namespace wo
         }
 
     private:
-        std::mutex _vm_hang_mx;
-        std::condition_variable _vm_hang_cv;
         std::atomic_int8_t _vm_hang_flag = 0;
 
         bool _vm_br_yieldable = false;
@@ -201,6 +218,21 @@ namespace wo
             return attaching_debuggee;
         }
 
+#ifdef WO_SINGLE_THREADED
+        // Only current thread accesses interrupt flags, read-modify-write is not needed.
+        inline bool interrupt(vm_interrupt_type type)
+        {
+            const uint32_t old_interrupt = vm_interrupt.load(std::memory_order_relaxed);
+            vm_interrupt.store(old_interrupt | type, std::memory_order_relaxed);
+            return !(type & old_interrupt);
+        }
+        inline bool clear_interrupt(vm_interrupt_type type)
+        {
+            const uint32_t old_interrupt = vm_interrupt.load(std::memory_order_relaxed);
+            vm_interrupt.store(old_interrupt & ~type, std::memory_order_relaxed);
+            return type & old_interrupt;
+        }
+#else
         inline bool interrupt(vm_interrupt_type type)
         {
             return !(type & vm_interrupt.fetch_or(type));
@@ -209,6 +241,7 @@ namespace wo
         {
             return type & vm_interrupt.fetch_and(~type);
         }
+#endif
         inline bool wait_interrupt(vm_interrupt_type type)
         {
             constexpr int MAX_TRY_COUNT = 0;
@@ -234,30 +267,57 @@ namespace wo
         }
         inline void block_interrupt(vm_interrupt_type type)
         {
+#ifdef WO_SINGLE_THREADED
+            // Nobody can clear interrupt for current thread, it will be handled in vm's safepoint.
+            return;
+#endif
             while (vm_interrupt & type)
                 std::this_thread::yield();
         }
 
+        inline static int64_t steady_time_ns()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
         inline void hangup()
         {
+            if (_vm_hang_flag.fetch_sub(1) > 0)
+                return; // Waked before hanging up.
+
+            bool slept = false;
             do
             {
-                std::lock_guard g1(_vm_hang_mx);
-                _vm_hang_flag.fetch_sub(1);
-            } while (0);
+                // Epoch must be read before checking flag, wakeup after checking will change it.
+                const uint32_t epoch = _vm_hang_epoch.load();
+                if (_vm_hang_flag.load() >= 0)
+                    break;
 
-            std::unique_lock ug1(_vm_hang_mx);
-            _vm_hang_cv.wait(ug1, [this]() {return _vm_hang_flag >= 0; });
+                osapi::futex_wait(&_vm_hang_epoch, epoch);
+                slept = true;
+            } while (true);
+
+            if (slept)
+            {
+                const int64_t resume_time = steady_time_ns() - _vm_resume_begin_time.load();
+                int64_t max_resume_time = _vm_max_resume_time.load();
+                while (resume_time > max_resume_time
+                    && !_vm_max_resume_time.compare_exchange_weak(max_resume_time, resume_time))
+                    ;
+                _vm_total_resume_time.fetch_add(resume_time);
+                _vm_resumed_count.fetch_add(1);
+            }
         }
+        // Hanged-up vm will not be resumed until resume_hanged_vms.
         inline void wakeup()
         {
-            do
-            {
-                std::lock_guard g1(_vm_hang_mx);
-                _vm_hang_flag.fetch_add(1);
-            } while (0);
-
-            _vm_hang_cv.notify_one();
+            _vm_hang_flag.fetch_add(1);
+        }
+        inline static void resume_hanged_vms()
+        {
+            _vm_resume_begin_time.store(steady_time_ns());
+            _vm_hang_epoch.fetch_add(1);
+            osapi::futex_wake_all(&_vm_hang_epoch);
         }
 
         inline void finish_veh()
@@ -343,16 +403,37 @@ namespace wo
             } while (0);
 
             finish_veh();
+            close_released_handles();
 
             if (compile_info)
                 delete compile_info;
 
             if (env)
                 --env->_running_on_vm_count;
+
+            if (gc_heap)
+                gcheap::remove_vm(gc_heap);
         }
 
         lexer* compile_info = nullptr;
 
+        // Counted gchandles released to zero while running, they are pinned until closed.
+        std::vector<gc_handle_base_t*> m_released_handles;
+
+        // Should be called with LEAVE_INTERRUPT, destructors of gchandles might wait for gc.
+        void close_released_handles()
+        {
+            clear_interrupt(vm_interrupt_type::RELEASED_HANDLE_INTERRUPT);
+
+            std::vector<gc_handle_base_t*> released_handles;
+            released_handles.swap(m_released_handles);
+            for (auto* handle : released_handles)
+            {
+                handle->close();
+                --handle->releasing_count;
+            }
+        }
+
         // vm exception handler
         exception_recovery* veh = nullptr;
 
@@ -376,6 +457,20 @@ namespace wo
 
         vmbase* gc_vm;
 
+        // Units created by this vm will be allocated in this heap, nullptr means default heap.
+        gcheap* gc_heap = nullptr;
+
+        // Stack slots from sp to gc_stack_watermark(exclusive) have been scanned in this gc round,
+        // remaining slots will be scanned by gc-thread after vms resumed, nullptr means no slot
+        // remained. Frames above watermark are guarded by return barrier, see gc_return_barrier.
+        std::atomic<value*> gc_stack_watermark = nullptr;
+        gcbase::rw_lock gc_stack_scan_mx;
+
+        // Returning by barriercallstack, scan the frame returned to if it was not scanned.
+        void gc_return_barrier(value* returning_callstack);
+        // Frame of frame_bp will be run, scan it if it was not scanned.
+        void gc_frame_barrier(value* frame_bp);
+
         shared_pointer<runtime_env> env;
         void set_runtime(ir_compiler& _compiler, size_t stacksz = 0)
         {
@@ -416,6 +511,9 @@ namespace wo
 
             new_vm->gc_vm = get_or_alloc_gcvm();
 
+            if ((new_vm->gc_heap = gc_heap))
+                gcheap::add_vm(gc_heap);
+
             // using LEAVE_INTERRUPT to stop GC
             new_vm->block_interrupt(GC_INTERRUPT);  // must not working when gc'
             wo_asure(new_vm->clear_interrupt(LEAVE_INTERRUPT));
@@ -926,6 +1024,23 @@ namespace wo
                         case instruct::extern_opcode_page_0::mkunion:
                             tmpos << "mkunion\t"; print_opnum1(); tmpos << ",\t id=" << *(uint16_t*)((this_command_ptr += 2) - 2);
                             break;
+                        case instruct::extern_opcode_page_0::idarr:
+                            tmpos << "idarr\t"; print_opnum1(); tmpos << ",\t"; print_opnum2(); break;
+                        case instruct::extern_opcode_page_0::nextarr:
+                            tmpos << "nextarr\t"; print_opnum1(); tmpos << ",\t"; print_opnum2(); break;
+                        case instruct::extern_opcode_page_0::jmptab:
+                        {
+                            uint16_t count = *(uint16_t*)((this_command_ptr += 2) - 2);
+                            tmpos << "jmptab\t" << count << ",\t[";
+                            for (uint16_t i = 0; i < count; ++i)
+                            {
+                                if (i != 0)
+                                    tmpos << ", ";
+                                tmpos << "+" << *(uint32_t*)((this_command_ptr += 4) - 4);
+                            }
+                            tmpos << "]";
+                            break;
+                        }
                         default:
                             tmpos << "??\t";
                             break;
@@ -991,7 +1106,8 @@ namespace wo
                     os << call_trace_count << ": ..." << std::endl;
                     break;
                 }
-                if (base_callstackinfo_ptr->type == value::valuetype::callstack)
+                if (base_callstackinfo_ptr->type == value::valuetype::callstack
+                    || base_callstackinfo_ptr->type == value::valuetype::barriercallstack)
                 {
                     src_location_info = &env->program_debug_info->get_src_location_by_runtime_ip(env->rt_codes + base_callstackinfo_ptr->ret_ip - (need_offset ? 1 : 0));
 
@@ -1024,7 +1140,8 @@ namespace wo
             while (base_callstackinfo_ptr <= this->stack_mem_begin)
             {
                 ++call_trace_count;
-                if (base_callstackinfo_ptr->type == value::valuetype::callstack)
+                if (base_callstackinfo_ptr->type == value::valuetype::callstack
+                    || base_callstackinfo_ptr->type == value::valuetype::barriercallstack)
                 {
 
                     base_callstackinfo_ptr = this->stack_mem_begin - base_callstackinfo_ptr->bp;
@@ -1051,7 +1168,7 @@ namespace wo
             {
                 auto* return_sp = sp;
 
-                (sp--)->set_native_callstack(ip);
+                (sp--)->init_nil()->set_native_callstack(ip);
                 ip = env->rt_codes + wo_func_addr;
                 tc->set_integer(argc);
                 bp = sp;
@@ -1069,7 +1186,7 @@ namespace wo
                 wo_fail(WO_FAIL_CALL_FAIL, "Cannot call a 'nil' function.");
             else
             {
-                wo::gcbase::gc_read_guard rg1(wo_func_addr);
+                // Closure will not be modified after created, skip to lock.
                 if (!wo_func_addr->m_function_addr)
                     wo_fail(WO_FAIL_CALL_FAIL, "Cannot call a 'nil' function.");
                 else
@@ -1079,9 +1196,9 @@ namespace wo
                     for (auto idx = wo_func_addr->m_closure_args.rbegin();
                         idx != wo_func_addr->m_closure_args.rend();
                         ++idx)
-                        (sp--)->set_trans(&*idx);
+                        (sp--)->init_nil()->set_trans(&*idx);
 
-                    (sp--)->set_native_callstack(ip);
+                    (sp--)->init_nil()->set_native_callstack(ip);
                     ip = env->rt_codes + wo_func_addr->m_function_addr;
                     tc->set_integer(argc);
                     bp = sp;
@@ -1105,7 +1222,7 @@ namespace wo
                 auto* return_sp = sp + argc;
                 auto* return_bp = bp;
 
-                (sp--)->set_native_callstack(ip);
+                (sp--)->init_nil()->set_native_callstack(ip);
                 ip = env->rt_codes + wo_func_addr;
                 tc->set_integer(argc);
                 bp = sp;
@@ -1113,6 +1230,7 @@ namespace wo
                 run();
 
                 ip = return_ip;
+                value::release_popped_slots(sp + 1, return_sp + 1, cr);
                 sp = return_sp;
                 bp = return_bp;
 
@@ -1133,7 +1251,7 @@ namespace wo
                 auto* return_sp = sp + argc;
                 auto* return_bp = bp;
 
-                (sp--)->set_native_callstack(ip);
+                (sp--)->init_nil()->set_native_callstack(ip);
                 ip = env->rt_codes + wo_func_addr;
                 tc->set_integer(argc);
                 bp = sp;
@@ -1145,6 +1263,7 @@ namespace wo
                     );
 
                 ip = return_ip;
+                value::release_popped_slots(sp + 1, return_sp + 1, cr);
                 sp = return_sp;
                 bp = return_bp;
 
@@ -1161,7 +1280,7 @@ namespace wo
                 wo_fail(WO_FAIL_CALL_FAIL, "Cannot call a 'nil' function.");
             else
             {
-                wo::gcbase::gc_read_guard rg1(wo_func_closure);
+                // Closure will not be modified after created, skip to lock.
                 if (!wo_func_closure->m_function_addr)
                     wo_fail(WO_FAIL_CALL_FAIL, "Cannot call a 'nil' function.");
                 else
@@ -1173,9 +1292,9 @@ namespace wo
                     for (auto idx = wo_func_closure->m_closure_args.rbegin();
                         idx != wo_func_closure->m_closure_args.rend();
                         ++idx)
-                        (sp--)->set_trans(&*idx);
+                        (sp--)->init_nil()->set_trans(&*idx);
 
-                    (sp--)->set_native_callstack(ip);
+                    (sp--)->init_nil()->set_native_callstack(ip);
                     ip = env->rt_codes + wo_func_closure->m_function_addr;
                     tc->set_integer(argc);
                     bp = sp;
@@ -1183,6 +1302,7 @@ namespace wo
                     run();
 
                     ip = return_ip;
+                    value::release_popped_slots(sp + 1, return_sp + 1, cr);
                     sp = return_sp;
                     bp = return_bp;
 
@@ -1299,6 +1419,8 @@ namespace wo
                 ~auto_leave()
                 {
                     wo_asure(vm->interrupt(vm_interrupt_type::LEAVE_INTERRUPT));
+                    if (!vm->m_released_handles.empty())
+                        vm->close_released_handles();
                 }
             };
             // used for restoring IP
@@ -1356,6 +1478,8 @@ namespace wo
             ip_restore_raii_stack _o4((void*&)_this_thread_vm, (void*&)_nullptr);
             _nullptr = last_this_thread_vm;
 
+            gcheap::thread_heap_guard _o5(gc_heap);
+
             wo_assert(rt_env->reg_begin == rt_env->constant_global_reg_rtstack
                 + rt_env->constant_and_global_value_takeplace_count);
 
@@ -1423,13 +1547,13 @@ namespace wo
                         if (dr & 0b01)
                         {
                             WO_ADDRESSING_N1_REF;
-                            (rt_sp--)->set_val(opnum1);
+                            (rt_sp--)->init_nil()->set_val(opnum1);
                         }
                         else
                         {
                             uint16_t psh_repeat = WO_IPVAL_MOVE_2;
                             for (uint32_t i = 0; i < psh_repeat; i++)
-                                (rt_sp--)->set_nil();
+                                (rt_sp--)->init_nil();
                         }
                         wo_assert(rt_sp <= rt_bp);
                         break;
@@ -1438,7 +1562,7 @@ namespace wo
                     {
                         WO_ADDRESSING_N1_REF;
 
-                        (rt_sp--)->set_ref(opnum1);
+                        (rt_sp--)->init_nil()->set_ref(opnum1);
 
                         wo_assert(rt_sp <= rt_bp);
 
@@ -1449,10 +1573,16 @@ namespace wo
                         if (dr & 0b01)
                         {
                             WO_ADDRESSING_N1_REF;
-                            opnum1->set_val((++rt_sp));
+                            opnum1->set_val(rt_sp + 1);
+                            value::release_popped_slots(rt_sp + 1, rt_sp + 2, rt_cr);
+                            ++rt_sp;
                         }
                         else
-                            rt_sp += WO_IPVAL_MOVE_2;
+                        {
+                            uint16_t pop_count = WO_IPVAL_MOVE_2;
+                            value::release_popped_slots(rt_sp + 1, rt_sp + 1 + pop_count, rt_cr);
+                            rt_sp += pop_count;
+                        }
 
                         wo_assert(rt_sp <= rt_bp);
 
@@ -2755,15 +2885,24 @@ namespace wo
                             rt_cr->set_val(rt_cr->get());*/
 
                         wo_assert((rt_bp + 1)->type == value::valuetype::callstack
-                            || (rt_bp + 1)->type == value::valuetype::nativecallstack);
+                            || (rt_bp + 1)->type == value::valuetype::nativecallstack
+                            || (rt_bp + 1)->type == value::valuetype::barriercallstack);
 
                         uint16_t pop_count = dr ? WO_IPVAL_MOVE_2 : 0;
 
-                        if ((++rt_bp)->type == value::valuetype::nativecallstack)
+                        // Locals & arguments of the frame.
+                        value::release_popped_slots(rt_sp + 1, rt_bp + 1, rt_cr);
+                        value::release_popped_slots(rt_bp + 2, rt_bp + 2 + pop_count, rt_cr);
+
+                        if ((++rt_bp)->type != value::valuetype::callstack)
                         {
-                            rt_sp = rt_bp;
-                            rt_sp += pop_count;
-                            return; // last stack is native_func, just do return; stack balance should be keeped by invoker
+                            if (rt_bp->type == value::valuetype::nativecallstack)
+                            {
+                                rt_sp = rt_bp;
+                                rt_sp += pop_count;
+                                return; // last stack is native_func, just do return; stack balance should be keeped by invoker
+                            }
+                            gc_return_barrier(rt_bp);
                         }
 
                         value* stored_bp = stack_mem_begin - rt_bp->bp;
@@ -2788,15 +2927,15 @@ namespace wo
 
                         if (opnum1->type == value::valuetype::closure_type)
                         {
-                            gcbase::gc_read_guard gwg1(opnum1->closure);
                             // Call closure, unpack closure captured arguments.
+                            // Closure will not be modified after created, skip to lock.
                             // 
                             // NOTE: Closure arguments should be poped by closure function it self.
                             //       Can use ret(n) to pop arguments when call.
                             for (auto res = opnum1->closure->m_closure_args.rbegin();
                                 res != opnum1->closure->m_closure_args.rend();
                                 ++res)
-                                (rt_sp--)->set_trans(&*res);
+                                (rt_sp--)->init_nil()->set_trans(&*res);
                         }
 
                         rt_sp->type = value::valuetype::callstack;
@@ -2816,8 +2955,14 @@ namespace wo
                             call_aim_native_func(reinterpret_cast<wo_vm>(this), reinterpret_cast<wo_value>(rt_sp + 2), tc->integer);
                             wo_asure(clear_interrupt(vm_interrupt_type::LEAVE_INTERRUPT));
 
-                            wo_assert((rt_bp + 1)->type == value::valuetype::callstack);
-                            value* stored_bp = stack_mem_begin - (++rt_bp)->bp;
+                            // Values left by native function.
+                            value::release_popped_slots(sp + 1, rt_sp + 1, rt_cr);
+
+                            wo_assert((rt_bp + 1)->type == value::valuetype::callstack
+                                || (rt_bp + 1)->type == value::valuetype::barriercallstack);
+                            if ((++rt_bp)->type != value::valuetype::callstack)
+                                gc_return_barrier(rt_bp);
+                            value* stored_bp = stack_mem_begin - rt_bp->bp;
                             rt_sp = rt_bp;
                             rt_bp = stored_bp;
                         }
@@ -2854,8 +2999,14 @@ namespace wo
                             call_aim_native_func(reinterpret_cast<wo_vm>(this), reinterpret_cast<wo_value>(rt_sp + 2), tc->integer);
                             wo_asure(clear_interrupt(vm_interrupt_type::LEAVE_INTERRUPT));
 
-                            wo_assert((rt_bp + 1)->type == value::valuetype::callstack);
-                            value* stored_bp = stack_mem_begin - (++rt_bp)->bp;
+                            // Values left by native function.
+                            value::release_popped_slots(sp + 1, rt_sp + 1, rt_cr);
+
+                            wo_assert((rt_bp + 1)->type == value::valuetype::callstack
+                                || (rt_bp + 1)->type == value::valuetype::barriercallstack);
+                            if ((++rt_bp)->type != value::valuetype::callstack)
+                                gc_return_barrier(rt_bp);
+                            value* stored_bp = stack_mem_begin - rt_bp->bp;
                             rt_sp = rt_bp;
                             rt_bp = stored_bp;
                         }
@@ -2905,6 +3056,7 @@ namespace wo
                         for (size_t i = 0; i < size; i++)
                             new_struct->m_values[i].set_trans(rt_sp + 1 + i);
 
+                        value::release_popped_slots(rt_sp + 1, rt_sp + 1 + size, rt_cr);
                         rt_sp += size;
 
                         break;
@@ -2922,9 +3074,12 @@ namespace wo
                         else
                         {
                             // STRUCT IT'SELF WILL NOT BE MODIFY, SKIP TO LOCK!
-                            gcbase::gc_read_guard gwg1(opnum2->structs);
+                            value* result;
+                            gcbase::gc_optimistic_read(opnum2->structs, [&]()
+                                {
+                                    result = opnum2->structs->m_values[offset].get();
+                                });
 
-                            auto* result = opnum2->structs->m_values[offset].get();
                             if (wo::gc::gc_is_marking())
                                 opnum2->structs->add_memo(result);
                             opnum1->set_ref(result);
@@ -2960,9 +3115,11 @@ namespace wo
                         created_array->resize((size_t)opnum2->integer);
                         for (size_t i = 0; i < (size_t)opnum2->integer; i++)
                         {
-                            auto* arr_val = ++rt_sp;
+                            auto* arr_val = rt_sp + 1 + i;
                             (*created_array)[i].set_trans(arr_val);
                         }
+                        value::release_popped_slots(rt_sp + 1, rt_sp + 1 + (size_t)opnum2->integer, rt_cr);
+                        rt_sp += (size_t)opnum2->integer;
                         break;
                     }
                     case instruct::opcode::mkmap:
@@ -2980,10 +3137,14 @@ namespace wo
 
                         for (size_t i = 0; i < (size_t)opnum2->integer; i++)
                         {
-                            value* val = ++rt_sp;
-                            value* key = ++rt_sp;
+                            value* val = rt_sp + 1 + 2 * i;
+                            value* key = val + 1;
+                            // Key is copied into map without setter.
+                            key->get()->hold_counted_handle();
                             (*created_map)[*(key->get())].set_trans(val);
                         }
+                        value::release_popped_slots(rt_sp + 1, rt_sp + 1 + 2 * (size_t)opnum2->integer, rt_cr);
+                        rt_sp += 2 * (size_t)opnum2->integer;
                         break;
                     }
                     case instruct::opcode::idx:
@@ -3018,6 +3179,7 @@ namespace wo
                             }
                             case value::valuetype::array_type:
                             {
+                                // Buffer might be reallocated & freed by writer, keep it while reading.
                                 gcbase::gc_read_guard gwg1(rt_ths->gcunit);
                                 if (opnum2->type == value::valuetype::integer_type || opnum2->type == value::valuetype::handle_type)
                                 {
@@ -3056,6 +3218,7 @@ namespace wo
                                     }
                                 }
                                 gcbase::gc_write_guard gwg1(rt_ths->gcunit);
+                                opnum2->hold_counted_handle();
                                 auto* result = &(*rt_ths->mapping)[*opnum2];
                                 if (wo::gc::gc_is_marking())
                                     rt_ths->mapping->add_memo(result);
@@ -3134,8 +3297,8 @@ namespace wo
                                 }
                                 else if (opnum1->type == value::valuetype::struct_type)
                                 {
+                                    // Count of struct will not be changed, values are read optimistically.
                                     auto* arg_tuple = opnum1->structs;
-                                    gcbase::gc_read_guard gwg1(arg_tuple);
                                     if (opnum2->integer > 0)
                                     {
                                         if ((size_t)opnum2->integer > (size_t)arg_tuple->m_count)
@@ -3145,7 +3308,7 @@ namespace wo
                                         else
                                         {
                                             for (uint16_t i = (uint16_t)opnum2->integer; i > 0; --i)
-                                                (rt_sp--)->set_trans(&arg_tuple->m_values[i - 1]);
+                                                (rt_sp--)->init_nil()->set_trans_optimistically(arg_tuple, &arg_tuple->m_values[i - 1]);
                                         }
                                     }
                                     else
@@ -3155,7 +3318,7 @@ namespace wo
                                             WO_VM_FAIL(WO_FAIL_INDEX_FAIL, "The number of arguments required for unpack exceeds the number of arguments in the given arguments-package.");
                                         }
                                         for (uint16_t i = arg_tuple->m_count; i > 0; --i)
-                                            (rt_sp--)->set_trans(&arg_tuple->m_values[i - 1]);
+                                            (rt_sp--)->init_nil()->set_trans_optimistically(arg_tuple, &arg_tuple->m_values[i - 1]);
 
                                         tc->integer += (wo_integer_t)arg_tuple->m_count;
                                     }
@@ -3176,7 +3339,7 @@ namespace wo
                                             for (auto arg_idx = arg_array->rbegin() + (arg_array->size() - opnum2->integer);
                                                 arg_idx != arg_array->rend();
                                                 arg_idx++)
-                                                (rt_sp--)->set_trans(&*arg_idx);
+                                                (rt_sp--)->init_nil()->set_trans(&*arg_idx);
                                         }
                                     }
                                     else
@@ -3189,7 +3352,7 @@ namespace wo
                                             WO_VM_FAIL(WO_FAIL_INDEX_FAIL, "The number of arguments required for unpack exceeds the number of arguments in the given arguments-package.");
                                         }
                                         for (auto arg_idx = arg_array->rbegin(); arg_idx != arg_array->rend(); arg_idx++)
-                                            (rt_sp--)->set_trans(&*arg_idx);
+                                            (rt_sp--)->init_nil()->set_trans(&*arg_idx);
 
                                         tc->integer += arg_array->size();
                                     }
@@ -3221,9 +3384,11 @@ namespace wo
                                 created_closure->m_closure_args.resize(closure_arg_count);
                                 for (size_t i = 0; i < (size_t)closure_arg_count; i++)
                                 {
-                                    auto* arr_val = ++rt_sp;
+                                    auto* arr_val = rt_sp + 1 + i;
                                     created_closure->m_closure_args[i].set_trans(arr_val->get());
                                 }
+                                value::release_popped_slots(rt_sp + 1, rt_sp + 1 + closure_arg_count, rt_cr);
+                                rt_sp += closure_arg_count;
                                 break;
                             }
                             case instruct::extern_opcode_page_0::veh:
@@ -3261,6 +3426,82 @@ namespace wo
 
                                 break;
                             }
+                            case instruct::extern_opcode_page_0::idarr:
+                            {
+                                WO_ADDRESSING_N1_REF; // array
+                                WO_ADDRESSING_N2_REF; // index
+
+                                // Type of index has been checked by compiler, only check nil & range here.
+                                if (opnum1->type != value::valuetype::array_type || nullptr == opnum1->array)
+                                {
+                                    WO_VM_FAIL(WO_FAIL_ACCESS_NIL, "Trying to access is 'nil'.");
+                                    rt_cr->set_nil();
+                                    break;
+                                }
+
+                                // Buffer might be reallocated & freed by writer, keep it while reading.
+                                gcbase::gc_read_guard gwg1(opnum1->array);
+
+                                auto real_idx = opnum2->integer;
+                                if (real_idx < 0)
+                                    real_idx = opnum1->array->size() - (-real_idx);
+                                if ((size_t)real_idx >= opnum1->array->size())
+                                {
+                                    WO_VM_FAIL(WO_FAIL_INDEX_FAIL, "Index out of range.");
+                                    rt_cr->set_nil();
+                                }
+                                else
+                                {
+                                    auto* result = (*opnum1->array)[(size_t)real_idx].get();
+                                    if (wo::gc::gc_is_marking())
+                                        opnum1->array->add_memo(result);
+                                    rt_cr->set_ref(result);
+                                }
+                                break;
+                            }
+                            case instruct::extern_opcode_page_0::jmptab:
+                            {
+                                uint16_t count = WO_IPVAL_MOVE_2;
+                                const wo_integer_t index = rt_cr->get()->integer;
+
+                                if (index >= 0 && index < (wo_integer_t)count)
+                                {
+                                    rt_ip += 4 * (size_t)index;
+                                    uint32_t aimplace = WO_IPVAL_MOVE_4;
+                                    rt_ip = rt_env->rt_codes + aimplace;
+                                }
+                                else
+                                    rt_ip += 4 * (size_t)count;
+                                break;
+                            }
+                            case instruct::extern_opcode_page_0::nextarr:
+                            {
+                                WO_ADDRESSING_N1_REF; // array
+                                WO_ADDRESSING_N2_REF; // index, start from -1
+
+                                if (opnum1->type != value::valuetype::array_type || nullptr == opnum1->array)
+                                {
+                                    WO_VM_FAIL(WO_FAIL_ACCESS_NIL, "Trying to access is 'nil'.");
+                                    rt_cr->set_integer(0);
+                                    break;
+                                }
+
+                                // Buffer might be reallocated & freed by writer, keep it while reading.
+                                gcbase::gc_read_guard gwg1(opnum1->array);
+
+                                // Size of array might be changed in loop, so check it every time.
+                                if ((size_t)++opnum2->integer < opnum1->array->size())
+                                {
+                                    auto* result = (*opnum1->array)[(size_t)opnum2->integer].get();
+                                    if (wo::gc::gc_is_marking())
+                                        opnum1->array->add_memo(result);
+                                    rt_ths->set_ref(result);
+                                    rt_cr->set_integer(1);
+                                }
+                                else
+                                    rt_cr->set_integer(0);
+                                break;
+                            }
                             default:
                                 wo_error("Unknown instruct.");
                                 break;
@@ -3302,10 +3543,16 @@ namespace wo
                         --rt_ip;    // Move back one command.
                         if (vm_interrupt & vm_interrupt_type::GC_INTERRUPT)
                         {
-                            // write regist(sp) data, then clear interrupt mark.
+                            // write regist(sp, bp) data, then clear interrupt mark.
                             sp = rt_sp;
+                            bp = rt_bp;
+#ifdef WO_SINGLE_THREADED
+                            if (clear_interrupt(vm_interrupt_type::GC_INTERRUPT))
+                                gc::gc_work_at_safepoint();
+#else
                             if (clear_interrupt(vm_interrupt_type::GC_INTERRUPT))
                                 hangup();   // SLEEP UNTIL WAKE UP
+#endif
                         }
                         else if (vm_interrupt & vm_interrupt_type::EXCEPTION_ROLLBACK_INTERRUPT)
                         {
@@ -3313,6 +3560,10 @@ namespace wo
                             rt_ip = ip;
                             rt_sp = sp;
                             rt_bp = bp;
+
+                            // Frames might be skipped, donot run in the frame before it scanned by gc.
+                            if (gc_stack_watermark.load(std::memory_order_relaxed) != nullptr)
+                                gc_frame_barrier(rt_bp);
                         }
                         else if (vm_interrupt & vm_interrupt_type::ABORT_INTERRUPT)
                         {
@@ -3339,6 +3590,31 @@ namespace wo
                             else
                                 wo_fail(WO_FAIL_NOT_SUPPORT, "BR_YIELD_INTERRUPT only work at br_yieldable vm.");
                         }
+                        else if (vm_interrupt & vm_interrupt_type::MEMORY_QUOTA_INTERRUPT)
+                        {
+                            // Vm will not allocate while gc confirming, garbage can be freed by it.
+                            ip = rt_ip;
+                            sp = rt_sp;
+                            bp = rt_bp;
+                            wo_asure(interrupt(vm_interrupt_type::LEAVE_INTERRUPT));
+                            const bool quota_exceeded = gc::gc_confirm_memory_quota(
+                                gc_heap == nullptr ? &gcheap::default_heap : gc_heap);
+                            wo_asure(clear_interrupt(vm_interrupt_type::LEAVE_INTERRUPT));
+
+                            // Interrupt might be set again when flushing allocated bytes.
+                            clear_interrupt(vm_interrupt_type::MEMORY_QUOTA_INTERRUPT);
+                            if (quota_exceeded)
+                                WO_VM_FAIL(WO_FAIL_MEMORY_QUOTA, "Memory quota exceeded.");
+                        }
+                        else if (vm_interrupt & vm_interrupt_type::RELEASED_HANDLE_INTERRUPT)
+                        {
+                            ip = rt_ip;
+                            sp = rt_sp;
+                            bp = rt_bp;
+                            wo_asure(interrupt(vm_interrupt_type::LEAVE_INTERRUPT));
+                            close_released_handles();
+                            wo_asure(clear_interrupt(vm_interrupt_type::LEAVE_INTERRUPT));
+                        }
                         else if (vm_interrupt & vm_interrupt_type::LEAVE_INTERRUPT)
                         {
                             // That should not be happend...